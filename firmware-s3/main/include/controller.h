@@ -6,18 +6,77 @@
 
 void elev_motors_init(void);
 void steppers_init(void);
-void horz_home(void);
-void elev_home(void);
 void feed_task(void *arg);
+/* The axis tasks home their axis first, then serve move requests. Moves
+ * requested while homing are carried out once the switch is found. */
 void elev_task(void *arg);
 void horz_task(void *arg);
+bool axes_homed(void);
+/* Times the horizontal index pass found and fixed missed steps */
+uint32_t get_horz_drift_corrections(void);
+/* Find the fastest reliable cruise speed of both axes and keep it in NVS.
+ * Returns false unless both axes are homed and not tuning already. */
+bool steppers_self_tune(void);
 void horz_move_to_relative(uint32_t rel);
 void elev_move_to_relative(uint32_t rel);
+/* Move both axes so they arrive together, no sooner than deadline_ms (0 = as
+ * fast as the slower axis allows). Completion is signalled once for both. */
+void axes_move_to_relative(uint32_t horz_rel, uint32_t elev_rel, uint32_t deadline_ms);
+bool axes_wait_ready(uint32_t timeout_ms);
+bool elev_wait_ready(uint32_t timeout_ms);
+/* Sweep mode, the horizontal axis turns on continuously at speed 1..10 and
+ * balls are fed on the fly. Any horizontal move ends the sweep. */
+void horz_sweep_start(uint32_t speed);
+void horz_sweep_stop(void);
+/* Feed once the sweep passes aim rel, the feed counts as pending from now.
+ * Returns false unless the axis is sweeping. */
+bool horz_sweep_feed(uint32_t rel);
+/* Learned time from the feed motor starting until the ball is out */
+uint32_t get_feed_latency_us(void);
+/* Propulsion wheels, speed 1..10 is held by wheel_task from the current
+ * sense. wheels_wait_ready() returns true once both wheels are at speed. */
 void elev_motors_start(uint32_t speed, uint32_t spin);
+/* Same with speed in hundredths, 100..1000 */
+void elev_motors_start_centi(uint32_t speed_centi, uint32_t spin);
+/* Expected time until the wheels are at speed after elev_motors_start_centi() */
+uint32_t elev_motors_spinup_ms(uint32_t speed_centi, uint32_t spin);
 void elev_motors_stop(void);
+/* Calibration mode, while paused: run the wheels on back-EMF targets for a
+ * speed and spin and keep them as that table entry. Save keeps the table in
+ * NVS, reset restores the defaults. Starting the program ends the mode. */
+bool elev_motors_calibrate(uint32_t speed, uint32_t spin,
+                           uint32_t top_mv, uint32_t bottom_mv);
+bool elev_motors_cal_save(void);
+bool elev_motors_cal_reset(void);
+/* Applies the idle policy while paused, see frankenshot_idle_t */
+void elev_motors_idle(uint32_t paused_ms);
+void wheel_task(void *arg);
+bool wheels_wait_ready(uint32_t timeout_ms);
 void request_feed(void);
+/* Feed so the ball leaves at release_us (esp_timer time), the motor starts the
+ * learned latency earlier. A time that is too close feeds at once. */
+void request_feed_at(int64_t release_us);
+/* Drops a feed of request_feed_at() that has not started yet, false if there
+ * was none or the motor is already running */
+bool cancel_feed_request(void);
+/* Pre-staging, after each ball the feeder runs on until the next one is just
+ * short of the release, so the following feed lets it go almost at once */
+void feed_set_prestage(bool enable);
+bool is_feed_prestage(void);
+/* A jammed feed is retried a few times, then given up: the program pauses and
+ * is_feed_jammed() holds until the next feed request */
+bool is_feed_jammed(void);
+uint32_t get_feed_jams(void);
+uint32_t get_feed_jams_cleared(void);
 bool is_horz_ready(void);
 bool is_elev_ready(void);
 bool is_feed_pending(void);
+/* Blocks until no feed is pending, true if so within timeout_ms. release_us
+ * (may be NULL) gets the esp_timer time the last ball left the feeder. */
+bool feed_wait_done(uint32_t timeout_ms, int64_t *release_us);
+/* Measured 12 V rail, level 0..100 % and the low warning derived from it */
+uint32_t get_supply_mv(void);
+uint8_t get_battery_pct(void);
+bool is_battery_low(void);
 
 #endif // CONTROLLER_H
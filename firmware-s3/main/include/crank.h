@@ -0,0 +1,24 @@
+#ifndef CRANK_H
+#define CRANK_H
+
+#include <stdint.h>
+
+/* Geometry of the horizontal crank and slider, lengths in mm.
+ * The crank turns the rod, the rod pushes the slider, and the slider swings
+ * the launcher head around its pivot, pivot_arm away from the slider track.
+ * A pivot_arm of zero treats the aim as linear in slider travel. */
+typedef struct {
+    float crank_radius;
+    float rod_length;
+    float pivot_arm;
+} crank_geometry_t;
+
+/* Fill steps[0..count-1] with crank positions, counted from the dead centre
+ * where the slider sits at one end, for `count` aim angles evenly spaced from
+ * one end of the swing to the other. Every position lies within the first
+ * half turn of half_rev_steps; the mirrored position half_rev_steps * 2 - step
+ * gives the same aim. */
+void crank_build_aim_table(const crank_geometry_t *geo, int32_t half_rev_steps,
+                           int32_t *steps, uint32_t count);
+
+#endif // CRANK_H
@@ -11,7 +11,10 @@
 /* NimBLE GAP APIs */
 #include "host/ble_gap.h"
 
-/* Frankenshot configuration structure */
+/* Frankenshot configuration structure. Speed is 1..10, or with
+ * FRANKENSHOT_SPEED_FINE set the speed in tenths, 10..100. */
+#define FRANKENSHOT_SPEED_FINE 0x80
+
 typedef struct {
     uint8_t speed;
     uint8_t height;
@@ -29,19 +32,83 @@ typedef struct {
     frankenshot_config_t configs[FRANKENSHOT_PROGRAM_MAX_CONFIGS];
 } frankenshot_program_t;
 
+/* Frankenshot machine state, value of the status characteristic */
+typedef enum {
+    FRANKENSHOT_STATE_HOMING = 0,
+    FRANKENSHOT_STATE_READY = 1,
+    FRANKENSHOT_STATE_TUNING = 2,
+} frankenshot_state_t;
+
+/* Frankenshot command characteristic opcodes */
+typedef enum {
+    FRANKENSHOT_CMD_SELF_TUNE = 1,
+    FRANKENSHOT_CMD_CAL_SET = 2,    /* speed, spin, top mV, bottom mV (uint16 LE) */
+    FRANKENSHOT_CMD_CAL_SAVE = 3,
+    FRANKENSHOT_CMD_CAL_RESET = 4,
+    FRANKENSHOT_CMD_PRESTAGE = 5,   /* 0 = off, 1 = on, kept in NVS */
+} frankenshot_cmd_t;
+
+/* Frankenshot status characteristic payload */
+typedef struct __attribute__((packed)) {
+    uint8_t state;
+    uint16_t drift_corrections;     /* horizontal index corrections since boot */
+    uint16_t battery_mv;            /* the rail as measured, i.e. the battery under load */
+    uint8_t battery_pct;            /* from battery_mv, for a 12 V lead acid pack */
+    uint8_t flags;                  /* FRANKENSHOT_STATUS_* */
+    uint16_t feed_jams;             /* feeds that jammed since boot */
+    uint16_t feed_jams_cleared;     /* of those, cleared by a retry */
+} frankenshot_status_t;
+
+#define FRANKENSHOT_STATUS_BATTERY_LOW  (1 << 0)
+#define FRANKENSHOT_STATUS_PRESTAGE     (1 << 1)
+#define FRANKENSHOT_STATUS_FEED_JAMMED  (1 << 2)    /* retries failed, program paused */
+
+/* Frankenshot sweep characteristic payload */
+typedef enum {
+    FRANKENSHOT_SWEEP_OFF = 0,
+    FRANKENSHOT_SWEEP_HORIZONTAL = 1,   /* crank keeps turning, balls fed on the fly */
+} frankenshot_sweep_mode_t;
+
+#define FRANKENSHOT_SWEEP_MAX_SPEED 10
+
+typedef struct __attribute__((packed)) {
+    uint8_t mode;
+    uint8_t speed;                  /* 1..10, share of the horizontal cruise speed */
+} frankenshot_sweep_t;
+
+/* Frankenshot idle characteristic payload, what the wheels do while paused */
+typedef enum {
+    FRANKENSHOT_IDLE_STOP = 0,
+    FRANKENSHOT_IDLE_HOLD = 1,      /* keep the last speed */
+    FRANKENSHOT_IDLE_REDUCED = 2,   /* slow down to idle speed */
+} frankenshot_idle_policy_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t policy;
+    uint8_t speed;                  /* 1..10, for FRANKENSHOT_IDLE_REDUCED */
+    uint16_t timeout_s;             /* stop after this long paused, 0 = never */
+} frankenshot_idle_t;
+
 /* Public function declarations */
 void send_heart_rate_indication(void);
 void send_frankenshot_config_indication(void);
 void send_frankenshot_feeding_indication(void);
+void send_frankenshot_status_indication(void);
 void update_frankenshot_config(void);
 void update_frankenshot_feeding(void);
 void gatt_svr_register_cb(struct ble_gatt_register_ctxt *ctxt, void *arg);
 void gatt_svr_subscribe_cb(struct ble_gap_event *event);
 int gatt_svc_init(void);
 const frankenshot_config_t *get_frankenshot_config(void);
+uint32_t frankenshot_speed_centi(uint8_t speed);
 bool get_frankenshot_feeding(void);
+void pause_frankenshot_feeding(void);
 const frankenshot_program_t *get_frankenshot_program(void);
 void set_current_config_index(uint8_t idx);
 uint8_t get_current_config_index(void);
+void set_frankenshot_state(frankenshot_state_t state);
+frankenshot_state_t get_frankenshot_state(void);
+const frankenshot_sweep_t *get_frankenshot_sweep(void);
+const frankenshot_idle_t *get_frankenshot_idle(void);
 
 #endif // GATT_SVR_H
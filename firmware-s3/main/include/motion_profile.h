@@ -0,0 +1,33 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <stdint.h>
+
+/* Ramp tables hold step intervals in 1/256 us */
+#define MOTION_INTERVAL_FRAC_BITS   8
+#define MOTION_RAMP_MAX_STEPS       4096    // longest table an axis gets
+
+/* Speed profile of an axis, speeds in steps per second.
+ * Moves start at start_sps, ramp up with accel_sps2 towards max_sps and ramp
+ * back down so that the last step is issued at start_sps again. With a
+ * non-zero jerk_sps3 the acceleration itself is ramped (S-curve), zero gives
+ * a plain trapezoid. */
+typedef struct {
+    uint32_t start_sps;
+    uint32_t max_sps;
+    uint32_t accel_sps2;
+    uint32_t jerk_sps3;
+} step_profile_t;
+
+/* Entries the ramp of a profile needs, cruise interval included */
+uint32_t motion_profile_ramp_steps(const step_profile_t *profile);
+
+/* Precompute the acceleration ramp of a profile. intervals[k] is the time
+ * between step k and step k+1 while accelerating from start speed, the last
+ * entry is the cruise interval. If max_len is too short the ramp ends at the
+ * speed reached by then, which becomes the cruise speed. Returns the number of
+ * entries written. */
+uint32_t motion_profile_build_ramp(const step_profile_t *profile,
+                                   uint32_t *intervals, uint32_t max_len);
+
+#endif // MOTION_PROFILE_H
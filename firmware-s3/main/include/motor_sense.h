@@ -0,0 +1,27 @@
+#ifndef MOTOR_SENSE_H
+#define MOTOR_SENSE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+
+/*
+ * Motor sense
+ *
+ * Analog inputs of the motor drivers, such as the BTS7960 IS current sense
+ * outputs, read through ADC1 with the factory calibration. Pins are added
+ * once at start up, readings are averaged over a burst of conversions so the
+ * PWM ripple on the inputs cancels out.
+ */
+
+#define MOTOR_SENSE_MAX_INPUTS  4
+
+/* Configure the pin as an ADC input, returns its input number or -1 if the
+ * pin has no ADC1 channel or the ADC could not be set up */
+int motor_sense_add(gpio_num_t gpio);
+
+/* Mean of `samples` conversions in mV at the pin, -1 on error */
+int32_t motor_sense_read_mv(int input, uint32_t samples);
+
+#endif // MOTOR_SENSE_H
@@ -0,0 +1,17 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/*
+ * Per machine settings kept in NVS, such as tuned step rates. Values are
+ * stored as blobs under a short key (max 15 characters) and only read back
+ * if their size still matches. NVS must be initialised first.
+ */
+
+esp_err_t settings_load(const char *key, void *value, size_t len);
+esp_err_t settings_save(const char *key, const void *value, size_t len);
+
+#endif // SETTINGS_H
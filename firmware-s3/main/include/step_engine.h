@@ -0,0 +1,98 @@
+#ifndef STEP_ENGINE_H
+#define STEP_ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "motion_profile.h"
+
+/*
+ * Step engine
+ *
+ * Generates the STEP pulses of both steppers from a single gptimer. The timer
+ * ISR toggles the STEP pins and counts positions, tasks only hand over targets
+ * and get called back once an axis has come to rest.
+ */
+
+typedef enum {
+    STEP_AXIS_HORZ,
+    STEP_AXIS_ELEV,
+    STEP_AXIS_COUNT
+} step_axis_t;
+
+/* Called from the timer ISR when a move or seek has finished.
+ * Return true if a higher priority task has been woken. */
+typedef bool (*step_done_cb_t)(step_axis_t axis, void *ctx);
+
+/* Called from the GPIO ISR when a watched switch changes during a move, with
+ * the position and direction at that step. Return true if a higher priority
+ * task has been woken. */
+typedef bool (*step_watch_cb_t)(step_axis_t axis, int32_t position, int8_t dir,
+                                void *ctx);
+
+void step_engine_axis_init(step_axis_t axis, gpio_num_t step_gpio,
+                           const step_profile_t *profile,
+                           step_done_cb_t done_cb, void *ctx);
+/* Rebuilds the ramp table of the axis, call from task context. Returns the
+ * cruise speed, below max_sps if the ramp would not fit MOTION_RAMP_MAX_STEPS. */
+uint32_t step_engine_set_profile(step_axis_t axis, const step_profile_t *profile);
+
+/* Issue `steps` pulses, dir is +1 or -1 and only affects position counting,
+ * the DIR pin is owned by the caller. A non-zero duration_us slows the whole
+ * profile down so the move takes that long, 0 moves as fast as the profile
+ * allows. The profile is stretched 16 times at most, a longer duration holds
+ * the axis for the difference before the first step so it still ends on time. */
+void step_engine_move(step_axis_t axis, int32_t steps, int8_t dir,
+                      uint32_t duration_us);
+
+/* Step on until retargeted or stopped, ramping up to sps at most */
+void step_engine_run(step_axis_t axis, int8_t dir, uint32_t sps);
+
+/* Time a move of `steps` takes at full profile speed */
+uint32_t step_engine_move_duration_us(step_axis_t axis, int32_t steps);
+
+/* Step at sps until switch_gpio reads `level` for a few consecutive steps,
+ * 0 seeks at the start speed. The switch edge is latched by a GPIO interrupt,
+ * see step_engine_seek_latch(). Seeks faster than the start speed ramp up like
+ * a move and, once the switch is confirmed, ramp down again, overshooting it
+ * by the stopping distance. A non-zero max_steps gives up after that many
+ * steps, the latch then reports nothing found. */
+void step_engine_seek(step_axis_t axis, int8_t dir, gpio_num_t switch_gpio,
+                      bool level, uint32_t sps, int32_t max_steps);
+
+/* Position at which the last seek saw the switch change, returns false if the
+ * seek never got there */
+bool step_engine_seek_latch(step_axis_t axis, int32_t *position);
+
+/* Change the end point of the running move. Returns true if the move now ends
+ * at target, at the pace already set, the duration of the move is not kept. Otherwise target is behind the axis or too close to stop in time,
+ * the axis decelerates to rest instead and the caller issues a new move once
+ * it has finished. */
+bool step_engine_retarget(step_axis_t axis, int32_t target);
+
+/* Steps the axis needs to come to rest from its current speed, 0 when idle.
+ * A retarget at least this far ahead is reachable. */
+uint32_t step_engine_stop_steps(step_axis_t axis);
+
+/* Report switch_gpio changing to `level` while the axis moves, seeks keep
+ * using the switch as before. */
+void step_engine_watch(step_axis_t axis, gpio_num_t switch_gpio, bool level,
+                       step_watch_cb_t cb, void *ctx);
+
+/* Shift the counted position by offset, e.g. after missed steps were found.
+ * A running move keeps its end point unless that is now too close to stop. */
+void step_engine_correct(step_axis_t axis, int32_t offset);
+
+/* Call cb from the timer ISR once, as the axis steps onto or past position in
+ * its direction of travel. A position already behind the axis fires on the
+ * next step. A NULL cb disarms a pending trigger. */
+void step_engine_trigger(step_axis_t axis, int32_t position,
+                         step_done_cb_t cb, void *ctx);
+
+void step_engine_stop(step_axis_t axis);
+bool step_engine_busy(step_axis_t axis);
+int32_t step_engine_get_position(step_axis_t axis);
+void step_engine_set_position(step_axis_t axis, int32_t pos);
+
+#endif // STEP_ENGINE_H
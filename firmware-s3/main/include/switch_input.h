@@ -0,0 +1,41 @@
+#ifndef SWITCH_INPUT_H
+#define SWITCH_INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+/*
+ * Switch input
+ *
+ * Switches read through GPIO edge interrupts. Each switch has its own
+ * debounce state: the first edge away from the stable level is taken at once
+ * and stamped with the time of the interrupt, bounces within the debounce
+ * window are ignored and the level is checked once more when the window ends,
+ * so a switch that settled the other way is still reported. Changes are posted
+ * to the queue given for the switch.
+ *
+ * The horizontal and elevation switches are not read here: the step engine
+ * takes their pin interrupt to latch the exact step, see step_engine_seek()
+ * and step_engine_watch(), and the controller debounces the index edges.
+ */
+
+#define SWITCH_INPUT_MAX_INPUTS  4
+
+typedef struct {
+    int input;              // as returned by switch_input_add()
+    bool level;             // debounced level after the change
+    int64_t time_us;        // esp_timer time of the edge
+} switch_event_t;
+
+/* Configure the pin as a pulled up input and watch it, changes are sent to
+ * queue, which holds switch_event_t items. Returns the input number or -1. */
+int switch_input_add(gpio_num_t gpio, uint32_t debounce_us, QueueHandle_t queue);
+
+/* Debounced level of the input */
+bool switch_input_level(int input);
+
+#endif // SWITCH_INPUT_H
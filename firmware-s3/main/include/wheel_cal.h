@@ -0,0 +1,45 @@
+#ifndef WHEEL_CAL_H
+#define WHEEL_CAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/*
+ * Wheel calibration
+ *
+ * Maps a shot, speed 1..10 and spin 0..10 with 5 = none, to the back-EMF
+ * each propulsion wheel has to hold. The table starts out from the linear
+ * spin split and is refined per machine in calibration mode, then kept in
+ * NVS. Speeds between the grid rows are interpolated.
+ */
+
+#define WHEEL_CAL_SPEEDS    10      // rows for speed 1..10
+#define WHEEL_CAL_SPINS     11      // columns for spin 0..10
+
+typedef struct {
+    uint16_t top_mv;
+    uint16_t bottom_mv;
+} wheel_cal_entry_t;
+
+/* Builds the default table, base = speed * full_mv / 10 split by
+ * base * (spin - 5) / spin_divisor and shifted down as a whole where the
+ * faster wheel would exceed max_mv, so heavy spin keeps its difference. The
+ * stored table replaces it if there is one, clamped to max_mv. max_mv has to be
+ * a back-EMF the wheels can reach. NVS must be initialised first. */
+void wheel_cal_init(uint32_t full_mv, uint32_t max_mv, uint32_t spin_divisor);
+
+/* Targets for speed in hundredths (100..1000) and spin 0..10 */
+void wheel_cal_lookup(uint32_t speed_centi, uint32_t spin,
+                      int32_t *top_mv, int32_t *bottom_mv);
+
+/* Replace one grid entry in RAM, false if out of range */
+bool wheel_cal_set(uint32_t speed, uint32_t spin, const wheel_cal_entry_t *entry);
+
+esp_err_t wheel_cal_save(void);
+
+/* Back to the default table, also in NVS */
+esp_err_t wheel_cal_reset(void);
+
+#endif // WHEEL_CAL_H
@@ -4,10 +4,13 @@
 #include "heart_rate.h"
 #include "controller.h"
 #include "led.h"
+#include "esp_timer.h"
 
 #include "host/ble_hs.h"
 #include "nimble/nimble_port.h"
 
+/* Staging ends this long before the feed motor has to start */
+#define PROGRAM_FEED_MARGIN_MS  100
 
 void ble_store_config_init(void);
 
@@ -59,6 +62,7 @@ static void indication_task(void *param) {
         send_heart_rate_indication();
         send_frankenshot_config_indication();
         send_frankenshot_feeding_indication();
+        send_frankenshot_status_indication();
 
         vTaskDelay(MOCK_RATE_TASK_PERIOD);
     }
@@ -67,7 +71,92 @@ static void indication_task(void *param) {
     vTaskDelete(NULL);
 }
 
+/* Steps 1-5 of a config, the ball is timed to leave at release_at_us, 0 for
+ * as soon as possible. Returns false if paused before the feed started or it jammed.
+ * release_us gets the time the ball left. */
+static bool program_position_feed(const frankenshot_config_t *cfg, int64_t release_at_us,
+                                  int64_t *release_us) {
+    /* 1. Position motors (coordinated, both arrive together) */
+    axes_move_to_relative(cfg->horizontal, cfg->height, 0);
+
+    /* 2. Start elevation motors */
+    elev_motors_start_centi(frankenshot_speed_centi(cfg->speed), cfg->spin);
+
+    /* 3. Wait for positioning, woken as soon as both axes are at rest and
+     *    the wheels at speed */
+    while (!axes_wait_ready(100)) {
+        if (!get_frankenshot_feeding()) return false;
+    }
+    while (!wheels_wait_ready(100)) {
+        if (!get_frankenshot_feeding()) return false;
+    }
+
+    /* 4. Feed ball, the motor starts the learned latency early so the ball
+     *    leaves on the beat */
+    request_feed_at(release_at_us);
+
+    /* 5. Wait for feed complete, woken as the ball is released. Once the
+     *    motor runs a pause waits too, the ball is already on its way */
+    while (!feed_wait_done(100, release_us)) {
+        if (!get_frankenshot_feeding() && cancel_feed_request()) return false;
+    }
+    return !is_feed_jammed();
+}
+
+/*
+ * Sweep variant of steps 1-5, the crank keeps turning and the feed is timed
+ * to release the ball as it passes the configured aim. Elevation still moves
+ * per config and has to be at rest. Returns false if paused meanwhile or the feed jammed.
+ */
+static bool program_sweep_feed(const frankenshot_config_t *cfg, int64_t *release_us) {
+    horz_sweep_start(get_frankenshot_sweep()->speed);
+    elev_move_to_relative(cfg->height);
+    elev_motors_start_centi(frankenshot_speed_centi(cfg->speed), cfg->spin);
+
+    while (!elev_wait_ready(100)) {
+        if (!get_frankenshot_feeding()) return false;
+    }
+    while (!wheels_wait_ready(100)) {
+        if (!get_frankenshot_feeding()) return false;
+    }
+    while (!horz_sweep_feed(cfg->horizontal)) {
+        /* Sweep not running yet, e.g. homing or a move still ending */
+        if (!get_frankenshot_feeding()) return false;
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    while (!feed_wait_done(100, release_us)) {
+        if (!get_frankenshot_feeding()) return false;
+    }
+    return !is_feed_jammed();
+}
+
+/*
+ * Moves and spins up for the next config while the time between balls runs
+ * down. The axes are paced to arrive as it ends, the wheels settle as fast as
+ * they can and hold. The feed steps find everything in place.
+ */
+static void program_prepare(const frankenshot_config_t *cfg, uint32_t deadline_ms) {
+    uint32_t speed_centi = frankenshot_speed_centi(cfg->speed);
+    uint32_t spinup_ms = elev_motors_spinup_ms(speed_centi, cfg->spin);
+
+    if (spinup_ms > deadline_ms) {
+        ESP_LOGW(TAG, "wheels need ~%lu ms to settle, %lu ms between balls",
+                 spinup_ms, deadline_ms);
+    }
+    elev_motors_start_centi(speed_centi, cfg->spin);
+
+    if (get_frankenshot_sweep()->mode == FRANKENSHOT_SWEEP_HORIZONTAL) {
+        elev_move_to_relative(cfg->height);
+    } else {
+        axes_move_to_relative(cfg->horizontal, cfg->height, deadline_ms);
+    }
+}
+
 static void program_task(void *param) {
+    bool sweeping = false;
+    int64_t paused_us = -1;
+    int64_t next_release_us = 0;
+
     ESP_LOGI(TAG, "program task started");
 
     while (1) {
@@ -75,10 +164,20 @@ static void program_task(void *param) {
 
         /* Wait for feeding enabled and valid program */
         if (!get_frankenshot_feeding() || prog->count == 0) {
-            elev_motors_stop();  /* Stop motors when paused */
+            /* Hold, slow or stop the wheels as the idle policy says */
+            if (paused_us < 0) {
+                paused_us = esp_timer_get_time();
+            }
+            elev_motors_idle((uint32_t)((esp_timer_get_time() - paused_us) / 1000));
+            if (sweeping) {
+                horz_sweep_stop();
+                sweeping = false;
+            }
+            next_release_us = 0;
             vTaskDelay(pdMS_TO_TICKS(100));
             continue;
         }
+        paused_us = -1;
 
         uint8_t idx = get_current_config_index();
         const frankenshot_config_t *cfg = &prog->configs[idx];
@@ -86,40 +185,34 @@ static void program_task(void *param) {
                  idx, cfg->speed, cfg->height, cfg->time_between_balls,
                  cfg->spin, cfg->horizontal);
 
-        /* 1. Position motors (parallel) */
-        horz_move_to_relative(cfg->horizontal);
-        elev_move_to_relative(cfg->height);
-
-        /* 2. Start elevation motors */
-        elev_motors_start(cfg->speed, cfg->spin);
-
-        /* 3. Wait for positioning */
-        while (!is_horz_ready() || !is_elev_ready()) {
-            if (!get_frankenshot_feeding()) break;
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-        if (!get_frankenshot_feeding()) continue;
-
-        /* 4. Feed ball */
-        request_feed();
-
-        /* 5. Wait for feed complete */
-        while (is_feed_pending()) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
+        /* 1-5. Aim and feed one ball, a plain move ends any sweep */
+        sweeping = get_frankenshot_sweep()->mode == FRANKENSHOT_SWEEP_HORIZONTAL;
+        int64_t release_us;
+        bool fed = sweeping ? program_sweep_feed(cfg, &release_us)
+                            : program_position_feed(cfg, next_release_us, &release_us);
+        if (!fed) continue;
 
         /* 6. Update current config for BLE indication */
         set_current_config_index(idx);
         send_frankenshot_config_indication();
 
-        /* 7. Wait time_between_balls */
-        for (int i = 0; i < cfg->time_between_balls * 10; i++) {
-            if (!get_frankenshot_feeding()) break;
-            vTaskDelay(pdMS_TO_TICKS(100));
+        /* 7. The next ball leaves time_between_balls after this one, the next
+         *    config is staged until its feed has to start. A sweep feed is
+         *    timed by the crank instead */
+        uint8_t next = (idx + 1) % prog->count;
+        next_release_us = release_us + cfg->time_between_balls * 1000000LL;
+        int64_t next_us = next_release_us;
+        if (!sweeping) {
+            next_us -= get_feed_latency_us() + PROGRAM_FEED_MARGIN_MS * 1000LL;
+        }
+        int64_t left_ms = (next_us - esp_timer_get_time()) / 1000;
+        program_prepare(&prog->configs[next], left_ms > 0 ? (uint32_t)left_ms : 0);
+        while (get_frankenshot_feeding() &&
+               (left_ms = (next_us - esp_timer_get_time()) / 1000) > 0) {
+            vTaskDelay(pdMS_TO_TICKS(left_ms < 100 ? left_ms : 100) + 1);
         }
 
         /* 8. Advance to next config */
-        uint8_t next = (idx + 1) % prog->count;
         set_current_config_index(next);
     }
 }
@@ -130,13 +223,6 @@ void app_main(void) {
 
     led_init();
 
-    /* Initialize motors and home steppers */
-    elev_motors_init();
-    horz_home();   /* Blocking - homes horizontal axis */
-    vTaskDelay(pdMS_TO_TICKS(10));
-    elev_home();   /* Blocking - homes elevation axis */
-    vTaskDelay(pdMS_TO_TICKS(10));
-
     /*
      * NVS flash initialization
      * Dependency of BLE stack to store configurations
@@ -152,6 +238,13 @@ void app_main(void) {
         return;
     }
 
+    /* Initialize motors, the axis tasks home both steppers concurrently
+     * while NimBLE comes up. Tuned step rates are read from NVS. */
+    elev_motors_init();
+    steppers_init();
+    xTaskCreate(horz_task, "Horizontal", 4*1024, NULL, 5, NULL);
+    xTaskCreate(elev_task, "Elevation", 4*1024, NULL, 5, NULL);
+
     /* NimBLE stack initialization */
     ret = nimble_port_init();
     if (ret != ESP_OK) {
@@ -186,9 +279,8 @@ void app_main(void) {
     xTaskCreate(indication_task, "Indicators", 4*1024, NULL, 5, NULL);
 
     /* Start controller tasks */
-    xTaskCreate(horz_task, "Horizontal", 4*1024, NULL, 5, NULL);
-    xTaskCreate(elev_task, "Elevation", 4*1024, NULL, 5, NULL);
     xTaskCreate(feed_task, "Feeder", 4*1024, NULL, 5, NULL);
+    xTaskCreate(wheel_task, "Wheels", 4*1024, NULL, 6, NULL);
     xTaskCreate(program_task, "Program", 4*1024, NULL, 5, NULL);
 
     return;
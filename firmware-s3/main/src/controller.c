@@ -1,13 +1,27 @@
 #include "common.h"
+#include <stddef.h>
 #include "driver/gpio.h"
 #include "driver/ledc.h"
+#include "esp_attr.h"
+#include "esp_system.h"
 #include "esp_timer.h"
-#include "esp_rom_sys.h"
 #include "led_strip.h"
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "controller.h"
+#include "step_engine.h"
+#include "crank.h"
+#include "gatt_svc.h"
+#include "settings.h"
+#include "motor_sense.h"
+#include "wheel_cal.h"
+#include "switch_input.h"
 
 static const char *HTAG = "HORZ";
 static const char *ETAG = "ELEV";
 static const char *FTAG = "FEED";
+static const char *WTAG = "WHEEL";
 
 /* ===== GPIO CONFIG ===== */
 #define RGB_LED_GPIO            38  // s3 on-board RGB LED
@@ -18,6 +32,9 @@ static const char *FTAG = "FEED";
 #define ELEV_BOTTOM_EN_GPIO     45
 #define ELEV_TOP_PWM_GPIO       36
 #define ELEV_TOP_EN_GPIO        37
+#define ELEV_BOTTOM_IS_GPIO     4    // R_IS current sense, ADC1
+#define ELEV_TOP_IS_GPIO        5
+#define SUPPLY_SENSE_GPIO       6    // 12 V rail through a 100k/10k divider, ADC1
 
 #define FEED_SWITCH_GPIO        14    // NC switch input
 #define HORZ_SWITCH_GPIO        12
@@ -34,27 +51,124 @@ static const char *FTAG = "FEED";
 /* ===== PWM CONFIG ===== */
 #define PWM_LEDC_TIMER       LEDC_TIMER_0
 #define PWM_LEDC_MODE        LEDC_LOW_SPEED_MODE
-#define PWM_LEDC_DUTY_RES    LEDC_TIMER_8_BIT      // 0–255
-#define PWM_LEDC_FREQUENCY   20000                 // 20 kHz
+#define PWM_LEDC_DUTY_RES    LEDC_TIMER_11_BIT     // 0–2047, the most 80 MHz allows at 20 kHz
+#define PWM_LEDC_FREQUENCY   20000                 // 20 kHz, inaudible
+#define PWM_MAX_DUTY         ((1 << PWM_LEDC_DUTY_RES) - 1)
 
-#define FEED_PWM_LOAD         90                    // ~40%
+#define FEED_PWM_LOAD         (PWM_MAX_DUTY * 35 / 100)
 #define ELEV_PWM_LOAD         100   
 
+// duty changes fade in hardware over this long, 0 = at once
+#define FEED_RAMP_MS          80
+#define WHEEL_RAMP_MS         300
+
 #define FEED_LEDC_CHANNEL          LEDC_CHANNEL_0
 #define ELEV_BOTTOM_LEDC_CHANNEL   LEDC_CHANNEL_1
 #define ELEV_TOP_LEDC_CHANNEL      LEDC_CHANNEL_2
 
-#define ELEV_MOTOR_MAX_DUTY   255   // max 255 for 8-bit resolution
+#define ELEV_MOTOR_MAX_DUTY   PWM_MAX_DUTY
 #define ELEV_SPIN_DIVISOR     25   // higher = weaker effect
 
+/* ===== WHEEL CONFIG ===== */
+// wheel speed is held on the back-EMF, estimated from the applied voltage and
+// the winding current the BTS7960 IS output reports
+#define WHEEL_LOOP_MS           10
+#define WHEEL_SENSE_SAMPLES     16     // conversions per reading, averages the PWM ripple
+#define WHEEL_SUPPLY_MV         12000  // nominal 12 V rail, until it has been measured
+#define WHEEL_IS_RATIO          8500   // BTS7960 kILIS, load current over IS current
+#define WHEEL_IS_RESISTOR_OHM   1000   // IS to GND
+#define WHEEL_MOTOR_R_MOHM      500    // winding resistance
+#define WHEEL_EMF_FULL_MV       11000  // back-EMF at speed 10
+// highest target, back-EMF stays below the rail by the IR drop and more so on a
+// sagging battery, spin at the top speeds shifts both wheels down instead
+#define WHEEL_EMF_MAX_MV        WHEEL_EMF_FULL_MV
+#define WHEEL_EMF_FILTER_SHIFT  2      // estimate low pass, 1/4 new sample per loop
+#define WHEEL_MIN_SENSE_DUTY    128    // below this the current reading is too noisy
+#define WHEEL_KP                0.16f  // duty counts per mV of speed error
+#define WHEEL_KI                0.80f  // duty counts per mV and second
+#define WHEEL_READY_TOL_MV      300    // within this of the target counts as at speed
+#define WHEEL_READY_LOOPS       10     // consecutive loops at speed before feeding
+#define WHEEL_SETTLE_TIMEOUT_MS 4000   // ready regardless, e.g. with the sensing broken
+// big speed changes drive full duty up, or zero duty down, before the PI loop
+// takes over close to the target
+#define WHEEL_BOOST_MIN_MV      1500   // smaller changes are left to the PI loop
+#define WHEEL_BOOST_EXIT_MV     400    // hand over this far short of the target
+#define WHEEL_BOOST_MV_PER_MS   8      // gain at full duty, times an open loop boost
+#define WHEEL_COAST_MV_PER_MS   6      // loss at zero duty, times every coast
+#define WHEEL_BOOST_MARGIN_MS   500    // a sensed boost ends this long after its plan at the latest
+
+/* ===== SUPPLY CONFIG ===== */
+// the wheel loop scales duty by the measured rail, the battery level follows it
+#define SUPPLY_DIVIDER_RATIO    11     // rail over ADC pin voltage
+#define SUPPLY_SENSE_LOOPS      10     // wheel loops between rail readings
+#define SUPPLY_FILTER_SHIFT     3
+#define SUPPLY_MIN_MV           6000   // below this the reading is taken as broken
+// The level assumes a 12 V sealed lead acid pack, resting voltages at full and
+// empty, linear in between. Another chemistry needs its own pair here.
+#define BATTERY_FULL_MV         12700
+#define BATTERY_EMPTY_MV        11600
+#define BATTERY_LOW_PCT         20     // warn below, clear again above low + hysteresis
+#define BATTERY_LOW_HYST_PCT    5
+
 /* ===== STEPPER CONFIG ===== */
 #define HORZ_STEP_DELAY_US     800   // ping delay, smaller = faster, 1000 safe, limited by Hz
 #define ELEV_STEP_DELAY_US     2000   // ping delay, smaller = faster, 1000 safe, limited by Hz
+// STEP pulses are generated by the step engine timer, see step_engine.c
+// the ping delays above are the start speed, moves ramp up from there
+#define STEP_DELAY_TO_SPS(us)  (1000000 / (2 * (us)))
+#define HORZ_MAX_SPS           2000   // cruise speed, steps per second
+#define HORZ_ACCEL_SPS2        4000   // steps per second^2
+#define HORZ_JERK_SPS3         40000  // steps per second^3, 0 = trapezoid
+#define ELEV_MAX_SPS           600
+#define ELEV_ACCEL_SPS2        1500
+#define ELEV_JERK_SPS3         15000
+
+// horizontal crank and slider, measured on the machine, see crank.h
+#define HORZ_CRANK_RADIUS_MM   20.0f
+#define HORZ_ROD_LENGTH_MM     60.0f
+#define HORZ_PIVOT_ARM_MM      80.0f
+#define HORZ_INDEX_OFFSET_STEPS 0     // steps from the crank dead centre to the index release
+#define HORZ_AIM_POSITIONS     11     // relative values 0..10
+#define HORZ_DRIFT_MAX_STEPS   200    // index seen further off than this is taken as noise
+#define HORZ_INDEX_DEADBAND_STEPS 2   // index this close is left alone, switch jitter
+#define HORZ_RETARGET_MARGIN_STEPS 8  // steps a sweep may take before its retarget lands
+
+/* ===== HOMING CONFIG ===== */
+// seek the switch fast, back off and approach it again slowly for the zero
+#define HORZ_HOME_FAST_SPS     HORZ_MAX_SPS
+#define HORZ_HOME_SLOW_SPS     200
+// no room below the elevation switch for a stopping ramp, seek at the start
+// speed so the axis stops on the switch
+#define ELEV_HOME_FAST_SPS     STEP_DELAY_TO_SPS(ELEV_STEP_DELAY_US)
+#define ELEV_HOME_SLOW_SPS     100
+#define HOME_BACKOFF_STEPS     40     // clearance in front of the switch for the slow pass
+#define HOME_VERIFY_STEPS      120    // warm start, slow pass gives up after this many steps
+
+/* ===== SELF TUNE CONFIG ===== */
+// the cruise speed is raised until a pass loses steps, the switches tell
+#define TUNE_STEP_PCT          115    // next candidate, percent of the last one
+#define TUNE_MARGIN_PCT        85     // stored speed, percent of the fastest clean pass
+#define TUNE_PASSES            3      // full range moves there and back per candidate
+#define TUNE_TOLERANCE_STEPS   4      // switch seen this far off still counts as clean
+#define HORZ_TUNE_MAX_SPS      6000
+#define ELEV_TUNE_MAX_SPS      2000
+
+/* ===== SWEEP CONFIG ===== */
+// the crank turns on without stopping, balls are fed as it passes the aim
+#define SWEEP_MAX_SPEED        10     // sweep speed 1..10 in tenths of the cruise speed
+#define SWEEP_FEED_MARGIN_STEPS 8     // feed request at least this far ahead of the crank
+#define FEED_LATENCY_DEFAULT_US 300000 // motor start to ball out, until a feed measured it
+#define FEED_LATENCY_GAIN_SHIFT 2      // each feed moves the learned latency by 1/4 of its error
 
 /* ===== SWITCH CONFIG ===== */
-#define DEBOUNCE_COUNT    3
+#define SWITCH_DEBOUNCE_US  5000    // bounces this soon after a change are ignored
+#define SWITCH_QUEUE_LEN    8
 #define FEED_TIMEOUT_MS   10000   // jam detection
-#define FEED_POLL_MS      10
+#define FEED_JAM_RETRIES  3       // tries after a jam before the program is paused
+#define FEED_BACKOFF_MS   300     // motor off so a stuck ball can settle
+#define FEED_RETRY_TIMEOUT_MS 3000
+#define FEED_POLL_MS      10      // only without the switch interrupt
+#define FEED_STAGE_LEAD_MS  60    // pre-staging stops at least this far short of the release
 
 
 # define MAIN 100
@@ -65,48 +179,211 @@ typedef enum {
     FEED_CLEAR_SWITCH,
     FEED_RUNNING,
     FEED_WAIT_RELEASE,
-    FEED_ERROR
+    FEED_STAGING,               // on after a release, the next ball is brought up
+    FEED_BACKOFF,               // jammed, off for a moment before trying again
+    FEED_ERROR                  // gave up, the next request tries afresh
 } feed_state_t;
 
+#define FEED_DONE_BIT     (1 << 0)    // nothing pending, cleared by a request
+
+/* ===== WHEELS ===== */
+#define WHEELS_READY_BIT  (1 << 0)
+
+typedef enum {
+    WHEEL_TRACK,                // PI loop on the target
+    WHEEL_BOOST,                // full duty towards a higher target
+    WHEEL_COAST                 // zero duty towards a lower target
+} wheel_phase_t;
+
+typedef struct {
+    ledc_channel_t channel;
+    int sense;                  // motor_sense input, -1 runs open loop
+    int32_t target_mv;          // back-EMF to hold, 0 = stopped
+    int32_t emf_mv;             // filtered estimate
+    float integral;             // duty counts
+    uint32_t duty;
+    uint32_t settled;           // consecutive loops within tolerance
+    wheel_phase_t phase;
+    int64_t phase_end_us;       // boost without current sense and coast end by time
+    int64_t fade_end_us;        // the loop leaves the duty alone until the fade is done
+} wheel_t;
+
+static wheel_t wheels[2];
+static SemaphoreHandle_t wheel_mutex = NULL;
+static EventGroupHandle_t wheel_events = NULL;
+static int64_t wheel_start_us = 0;
+// since when the wheels are off target, -1 while they are at speed
+static int64_t wheel_unready_us = -1;
+// measured 12 V rail, the wheel loop turns back-EMF targets into duty with it
+static int supply_sense = -1;
+static volatile uint32_t supply_mv = WHEEL_SUPPLY_MV;
+static volatile bool battery_low = false;
+// wheels run a calibration entry, the idle policy leaves them alone
+static bool wheel_cal_active = false;
+
+// fade time of each PWM channel, see pwm_set_ramp()
+static uint32_t pwm_ramp_ms[LEDC_CHANNEL_MAX];
+static bool pwm_fade_installed = false;
+
 static uint8_t s_led_state = 0;
 static led_strip_handle_t led_strip;
-static bool s_feed_requested = false;
+// requests wake feed_task by notification, completion is FEED_DONE_BIT
+static TaskHandle_t feed_task_handle = NULL;
+static EventGroupHandle_t feed_events = NULL;
+static volatile int64_t s_feed_release_us = 0;
+// starts a feed scheduled by request_feed_at()
+static esp_timer_handle_t feed_start_timer = NULL;
+// motor start to switch release, the ball leaves about then. Learned over the
+// session as it drifts with the hopper level, the deviation is its spread.
+static volatile uint32_t s_feed_latency_us = FEED_LATENCY_DEFAULT_US;
+static uint32_t s_feed_latency_dev_us = 0;
+static uint32_t s_feed_latency_samples = 0;
+// pre-staging runs the feeder on after each ball up to just short of the next
+// release, the staged time is what the next feed has already behind it
+static volatile bool s_feed_prestage = false;
+static volatile uint32_t s_feed_staged_us = 0;
+// jams since boot, those a retry got past, and whether the last feed gave up
+static uint32_t s_feed_jams = 0;
+static uint32_t s_feed_jams_cleared = 0;
+static volatile bool s_feed_jammed = false;
+// retries of the running feed and the state its last jam happened in
+static uint32_t feed_attempt = 0;
+static feed_state_t feed_jam_state = FEED_IDLE;
+static QueueHandle_t feed_switch_queue = NULL;
+static int feed_switch_input = -1;
 
 /* ===== HORZ ===== */
 typedef enum {
+    AXIS_CAL_VERIFY,
     AXIS_CAL_SEEK_1,
-    AXIS_CAL_WAIT_RELEASE_1,
+    AXIS_CAL_BACKOFF,
     AXIS_CAL_SEEK_2,
     AXIS_CAL_WAIT_RELEASE_2,
     AXIS_READY,
-    AXIS_MOVING
+    AXIS_MOVING,
+    AXIS_TUNING,
+    AXIS_SWEEPING
 } horz_axis_state_t;
 
 static horz_axis_state_t horz_axis_state;
-
-static int32_t horz_step_counter = 0;
-// steps from one end to the other
+// a move requested while homing, started once the index is found
+static bool horz_move_pending = false;
+// step rate of the running sweep, or of the one waiting for a move to end
+static uint32_t horz_sweep_sps = 0;
+static bool horz_sweep_pending = false;
+// a sweep feed is armed and waits for the crank to come round
+static volatile bool horz_feed_armed = false;
+
+// position is counted by the step engine, see step_engine_get_position()
+// steps from one end to the other, half a crank turn
 static int32_t horz_total_steps = 2800; 
+// crank position of each relative value, evenly spaced in aim angle
+static int32_t horz_aim_steps[HORZ_AIM_POSITIONS];
+// where the slow pass saw the switch pressed, relative to zero
+static int32_t horz_press_steps = 0;
+// the slow pass of the current homing run is bounded, see warm start
+static int32_t horz_seek_limit = 0;
+// index passes that found the counted position off, for diagnostics
+static volatile uint32_t horz_drift_corrections = 0;
+// position of the index edge last taken, later edges of the same pass are bounces
+static int32_t horz_index_last = 0;
+static bool horz_index_valid = false;
 static int32_t horz_target_steps = 0;
 static int32_t horz_dir = 0;
 static bool horz_stepper_enabled = true;
+// move commands and step engine completions, consumed by horz_task
+static QueueHandle_t horz_queue = NULL;
+// cruise speed in use, self tuned per machine, see horz_tune()
+static uint32_t horz_max_sps = HORZ_MAX_SPS;
+static const step_profile_t horz_profile = {
+    .start_sps = STEP_DELAY_TO_SPS(HORZ_STEP_DELAY_US),
+    .max_sps = HORZ_MAX_SPS,
+    .accel_sps2 = HORZ_ACCEL_SPS2,
+    .jerk_sps3 = HORZ_JERK_SPS3,
+};
 
 
 /* ===== ELEV ===== */
 typedef enum {
+    ELEV_CAL_VERIFY,
     ELEV_CAL_SEEK_1,
+    ELEV_CAL_BACKOFF,
+    ELEV_CAL_SEEK_2,
     ELEV_READY,
-    ELEV_MOVING
+    ELEV_MOVING,
+    ELEV_TUNING
 } elev_axis_state_t;
 
 static elev_axis_state_t elev_axis_state;
+static bool elev_move_pending = false;
+static int32_t elev_seek_limit = 0;
 
-static int32_t elev_step_counter = 0;
 // steps from one end to the other
 static int32_t elev_total_steps = 800; 
 static int32_t elev_target_steps = 0;
 static int32_t elev_dir = 0;
 static bool elev_stepper_enabled = true;
+// move commands and step engine completions, consumed by elev_task
+static QueueHandle_t elev_queue = NULL;
+static uint32_t elev_max_sps = ELEV_MAX_SPS;
+static const step_profile_t elev_profile = {
+    .start_sps = STEP_DELAY_TO_SPS(ELEV_STEP_DELAY_US),
+    .max_sps = ELEV_MAX_SPS,
+    .accel_sps2 = ELEV_ACCEL_SPS2,
+    .jerk_sps3 = ELEV_JERK_SPS3,
+};
+
+/* ===== AXIS COMMANDS ===== */
+#define AXIS_QUEUE_LEN        8
+#define AXIS_IDLE_CHECK_MS    100   // safety net should a DONE event get lost
+
+typedef enum {
+    AXIS_CMD_MOVE,      // go to target, retargets a running move
+    AXIS_CMD_DONE,      // posted by the step engine ISR once the axis stopped
+    AXIS_CMD_INDEX,     // index switch passed while moving, target is the position
+    AXIS_CMD_TUNE,      // find the fastest reliable cruise speed
+    AXIS_CMD_SWEEP      // turn on continuously, target is the step rate
+} axis_cmd_type_t;
+
+typedef struct {
+    axis_cmd_type_t type;
+    int32_t target;
+    uint32_t duration_us;
+} axis_cmd_t;
+
+/* ===== COORDINATED MOVES ===== */
+// set while the axis is at rest, both set = machine in position
+#define AXES_HORZ_READY_BIT   (1 << 0)
+#define AXES_ELEV_READY_BIT   (1 << 1)
+#define AXES_READY_BITS       (AXES_HORZ_READY_BIT | AXES_ELEV_READY_BIT)
+// set once the axis has found its switch after power on
+#define AXES_HORZ_HOMED_BIT   (1 << 2)
+#define AXES_ELEV_HOMED_BIT   (1 << 3)
+#define AXES_HOMED_BITS       (AXES_HORZ_HOMED_BIT | AXES_ELEV_HOMED_BIT)
+// set while the axis runs its self tune
+#define AXES_HORZ_TUNING_BIT  (1 << 4)
+#define AXES_ELEV_TUNING_BIT  (1 << 5)
+#define AXES_TUNING_BITS      (AXES_HORZ_TUNING_BIT | AXES_ELEV_TUNING_BIT)
+
+static EventGroupHandle_t axes_events = NULL;
+// orders posting a command against flagging the axis ready
+static SemaphoreHandle_t axes_cmd_lock = NULL;
+
+/* ===== WARM START ===== */
+// positions of axes at rest survive resets other than power on
+#define WARM_START_MAGIC      0x46524b53   // "FRKS"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t valid;         // AXES_*_HOMED_BIT of the axes at rest
+    int32_t horz_position;
+    int32_t horz_press;
+    int32_t elev_position;
+    uint32_t checksum;
+} warm_start_t;
+
+static RTC_NOINIT_ATTR warm_start_t warm_start;
+static portMUX_TYPE warm_start_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static inline bool timed_out(int64_t start_us, int timeout_ms)
 {
@@ -114,6 +391,254 @@ static inline bool timed_out(int64_t start_us, int timeout_ms)
            ((int64_t)timeout_ms * 1000);
 }
 
+static void axes_sync_init(void)
+{
+    // called from steppers_init, before the axis tasks exist
+    if (axes_events == NULL) {
+        axes_events = xEventGroupCreate();
+        axes_cmd_lock = xSemaphoreCreateMutex();
+    }
+}
+
+// the ready bit is only set once no further command is queued for the axis
+static void axes_set_ready_bit(QueueHandle_t queue, EventBits_t bit)
+{
+    xSemaphoreTake(axes_cmd_lock, portMAX_DELAY);
+    if (uxQueueMessagesWaiting(queue) == 0) {
+        xEventGroupSetBits(axes_events, bit);
+    }
+    xSemaphoreGive(axes_cmd_lock);
+}
+
+static bool axes_post_cmd(QueueHandle_t queue, EventBits_t bit,
+                          const axis_cmd_t *cmd)
+{
+    xSemaphoreTake(axes_cmd_lock, portMAX_DELAY);
+    bool posted = xQueueSend(queue, cmd, 0) == pdTRUE;
+    if (posted) {
+        xEventGroupClearBits(axes_events, bit);
+    }
+    xSemaphoreGive(axes_cmd_lock);
+    return posted;
+}
+
+static bool axes_post_move(QueueHandle_t queue, EventBits_t bit,
+                           int32_t target, uint32_t duration_us)
+{
+    axis_cmd_t cmd = {
+        .type = AXIS_CMD_MOVE,
+        .target = target,
+        .duration_us = duration_us,
+    };
+
+    return axes_post_cmd(queue, bit, &cmd);
+}
+
+// the base profile at another cruise speed, acceleration and jerk scale along
+// so the ramps take as long as before
+static step_profile_t profile_at_speed(const step_profile_t *base, uint32_t max_sps)
+{
+    step_profile_t profile = *base;
+
+    profile.max_sps = max_sps;
+    profile.accel_sps2 = (uint32_t)((uint64_t)base->accel_sps2 * max_sps / base->max_sps);
+    profile.jerk_sps3 = (uint32_t)((uint64_t)base->jerk_sps3 * max_sps / base->max_sps);
+    return profile;
+}
+
+// tuned cruise speed from NVS, the default if none has been stored yet
+static uint32_t tuned_max_sps(const char *key, const step_profile_t *base,
+                              uint32_t limit)
+{
+    uint32_t sps = 0;
+
+    if (settings_load(key, &sps, sizeof(sps)) != ESP_OK ||
+        sps <= base->start_sps || sps > limit) {
+        return base->max_sps;
+    }
+    ESP_LOGI(TAG, "%s: tuned cruise speed %lu", key, sps);
+    return sps;
+}
+
+// the fastest clean candidate less the margin, 0 if none was clean
+static uint32_t tune_result(const char *key, const step_profile_t *base,
+                            uint32_t best)
+{
+    uint32_t sps = best * TUNE_MARGIN_PCT / 100;
+
+    if (sps <= base->start_sps) {
+        ESP_LOGW(TAG, "%s: no reliable speed found, keeping %lu", key, base->max_sps);
+        return 0;
+    }
+    settings_save(key, &sps, sizeof(sps));
+    return sps;
+}
+
+/* Each axis task reports back once its self tune is over. An axis that homes
+ * again passes its homed bit, the state then stays homing until
+ * axes_set_homed_bit() sees both axes back. */
+static void axes_tune_done(EventBits_t bit, EventBits_t homed_bit)
+{
+    EventBits_t bits = xEventGroupClearBits(axes_events, bit | homed_bit);
+
+    bits &= ~(bit | homed_bit);
+    if ((bits & AXES_TUNING_BITS) == 0) {
+        ESP_LOGI(TAG, "Self tune finished");
+        set_frankenshot_state((bits & AXES_HOMED_BITS) == AXES_HOMED_BITS
+                              ? FRANKENSHOT_STATE_READY : FRANKENSHOT_STATE_HOMING);
+    }
+}
+
+static uint32_t warm_start_checksum(const warm_start_t *ws)
+{
+    const uint32_t *words = (const uint32_t *)ws;
+    uint32_t sum = 0x5a5a5a5a;
+
+    for (size_t i = 0; i < offsetof(warm_start_t, checksum) / sizeof(uint32_t); i++) {
+        sum = (sum << 5 | sum >> 27) ^ words[i];
+    }
+    return sum;
+}
+
+// keeps the record only if RTC memory has been kept alive since it was written
+static void warm_start_load(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    if (reason == ESP_RST_POWERON || reason == ESP_RST_UNKNOWN ||
+        warm_start.magic != WARM_START_MAGIC ||
+        warm_start.checksum != warm_start_checksum(&warm_start)) {
+        memset(&warm_start, 0, sizeof(warm_start));
+        warm_start.magic = WARM_START_MAGIC;
+        warm_start.checksum = warm_start_checksum(&warm_start);
+        return;
+    }
+    ESP_LOGI(TAG, "Warm start (reset reason %d), axes 0x%lx at rest",
+             reason, warm_start.valid);
+}
+
+// an axis position is only worth keeping while its driver is off
+static void warm_start_store(EventBits_t bit, int32_t position)
+{
+    portENTER_CRITICAL(&warm_start_lock);
+    if (bit == AXES_HORZ_HOMED_BIT) {
+        warm_start.horz_position = position;
+    } else {
+        warm_start.elev_position = position;
+    }
+    warm_start.valid |= bit;
+    warm_start.checksum = warm_start_checksum(&warm_start);
+    portEXIT_CRITICAL(&warm_start_lock);
+}
+
+static void warm_start_invalidate(EventBits_t bit)
+{
+    portENTER_CRITICAL(&warm_start_lock);
+    warm_start.valid &= ~bit;
+    warm_start.checksum = warm_start_checksum(&warm_start);
+    portEXIT_CRITICAL(&warm_start_lock);
+}
+
+// where the horizontal slow pass saw the index pressed, relative to zero
+static void warm_start_store_press(int32_t press)
+{
+    portENTER_CRITICAL(&warm_start_lock);
+    warm_start.horz_press = press;
+    warm_start.checksum = warm_start_checksum(&warm_start);
+    portEXIT_CRITICAL(&warm_start_lock);
+}
+
+static int32_t warm_start_press(void)
+{
+    portENTER_CRITICAL(&warm_start_lock);
+    int32_t press = warm_start.horz_press;
+    portEXIT_CRITICAL(&warm_start_lock);
+    return press;
+}
+
+static bool warm_start_position(EventBits_t bit, int32_t *position)
+{
+    bool valid;
+
+    portENTER_CRITICAL(&warm_start_lock);
+    valid = (warm_start.valid & bit) != 0;
+    *position = bit == AXES_HORZ_HOMED_BIT ? warm_start.horz_position
+                                           : warm_start.elev_position;
+    portEXIT_CRITICAL(&warm_start_lock);
+    return valid;
+}
+
+// steps back from where a fast seek came to rest to just before the switch
+static int32_t home_backoff_steps(step_axis_t axis, int8_t dir)
+{
+    int32_t pos = step_engine_get_position(axis);
+    int32_t edge = pos;
+
+    step_engine_seek_latch(axis, &edge);
+    return (pos - edge) * dir + HOME_BACKOFF_STEPS;
+}
+
+// steps the axis moved on since the seek saw the switch change
+static int32_t home_past_edge(step_axis_t axis)
+{
+    int32_t pos = step_engine_get_position(axis);
+    int32_t edge = pos;
+
+    step_engine_seek_latch(axis, &edge);
+    return pos - edge;
+}
+
+// last index edge passed on per axis, for the debounce below
+static int64_t axis_index_us[STEP_AXIS_COUNT];
+
+/*
+ * Index release seen during a move, ctx is the queue of the axis. The step
+ * engine owns the pin interrupt so it cannot go through switch_input, the
+ * same debounce window is applied here instead: the first edge is taken at
+ * once, bounces within SWITCH_DEBOUNCE_US of it are dropped.
+ */
+static bool IRAM_ATTR axis_index_seen(step_axis_t axis, int32_t position,
+                                      int8_t dir, void *ctx)
+{
+    axis_cmd_t index = {
+        .type = AXIS_CMD_INDEX,
+        .target = position,
+    };
+    BaseType_t woken = pdFALSE;
+    int64_t now = esp_timer_get_time();
+
+    // homing zeroes on the release while turning forward, only that edge repeats
+    if (dir > 0 && now - axis_index_us[axis] >= SWITCH_DEBOUNCE_US) {
+        axis_index_us[axis] = now;
+        xQueueSendFromISR((QueueHandle_t)ctx, &index, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+// both axes home concurrently, the app learns about it through the status
+static void axes_set_homed_bit(EventBits_t bit)
+{
+    EventBits_t bits = xEventGroupSetBits(axes_events, bit);
+
+    // an axis still tuning homes again once it is done
+    if ((bits & AXES_HOMED_BITS) == AXES_HOMED_BITS && !(bits & AXES_TUNING_BITS)) {
+        ESP_LOGI(TAG, "Both axes homed");
+        set_frankenshot_state(FRANKENSHOT_STATE_READY);
+    }
+}
+
+// step engine completion, ctx is the queue of the axis
+static bool IRAM_ATTR axis_step_done(step_axis_t axis, void *ctx)
+{
+    axis_cmd_t done = {
+        .type = AXIS_CMD_DONE,
+    };
+    BaseType_t woken = pdFALSE;
+
+    xQueueSendFromISR((QueueHandle_t)ctx, &done, &woken);
+    return woken == pdTRUE;
+}
+
 void led_on(void)
 {
     /* Set the LED pixel using RGB from 0 (0% power) to 255 (100% power) for each color */
@@ -157,81 +682,198 @@ void led_init(void)
     led_strip_clear(led_strip);
 }
 
-static bool debounce_switch(gpio_num_t gpio_num)
+// marks a feed as pending ahead of the request, false if there is no feeder
+static bool feed_arm(void)
 {
-    static bool last_raw = false;
-    static bool stable = false;
-    static uint8_t count = 0;
+    if (feed_events == NULL) {
+        ESP_LOGW(FTAG, "Feeder not running, feed dropped");
+        return false;
+    }
+    xEventGroupClearBits(feed_events, FEED_DONE_BIT);
+    return true;
+}
 
-    // NC connected to gpio, will return true if switch is triggered and wire disconnected
-    // which makes consumption for motor stop downstream safer
-    bool raw = gpio_get_level(gpio_num) == 1;
+// an armed feed that will not be requested after all
+static void feed_cancel(void)
+{
+    if (feed_events != NULL) {
+        xEventGroupSetBits(feed_events, FEED_DONE_BIT);
+    }
+}
+
+void request_feed(void)
+{
+    if (!feed_arm()) {
+        return;
+    }
+    xTaskNotifyGive(feed_task_handle);
+}
+
+// the feed must have been armed, returns true if the feeder has been woken
+static bool IRAM_ATTR request_feed_from_isr(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    vTaskNotifyGiveFromISR(feed_task_handle, &woken);
+    return woken == pdTRUE;
+}
+
+static void feed_start_fire(void *arg)
+{
+    xTaskNotifyGive(feed_task_handle);
+}
 
-    if (raw == last_raw) {
-        if (count < DEBOUNCE_COUNT) {
-            count++;
+void request_feed_at(int64_t release_us)
+{
+    if (!feed_arm()) {
+        return;
+    }
+    // a feed still scheduled is replaced, starting the timer again would fail
+    if (feed_start_timer != NULL && esp_timer_stop(feed_start_timer) == ESP_OK) {
+        ESP_LOGW(FTAG, "Scheduled feed replaced");
+    }
+
+    int64_t start_us = release_us - get_feed_latency_us();
+    int64_t now = esp_timer_get_time();
+    if (start_us <= now) {
+        if (release_us > 0 && now - start_us > 1000) {
+            ESP_LOGW(FTAG, "Feed %lld ms behind the beat", (now - start_us) / 1000);
         }
-    } else {
-        count = 0;
+        xTaskNotifyGive(feed_task_handle);
+        return;
+    }
+    esp_err_t err = esp_timer_start_once(feed_start_timer, start_us - now);
+    if (err != ESP_OK) {
+        ESP_LOGE(FTAG, "Feed timer failed: %s, feeding now", esp_err_to_name(err));
+        xTaskNotifyGive(feed_task_handle);
     }
+}
 
-    if (count >= DEBOUNCE_COUNT) {
-        stable = raw;
+bool cancel_feed_request(void)
+{
+    if (feed_start_timer == NULL || esp_timer_stop(feed_start_timer) != ESP_OK) {
+        // not scheduled or already started
+        return false;
     }
+    feed_cancel();
+    return true;
+}
+
+/*
+ * Folds one start to release time into the latency model, the mean and mean
+ * deviation are tracked as exponential averages, so the model follows the
+ * hopper emptying but a single odd ball moves it by a quarter only.
+ */
+static void feed_learn_latency(uint32_t sample_us)
+{
+    int32_t err = (int32_t)(sample_us - s_feed_latency_us);
 
-    last_raw = raw;
-    return stable;
+    if (s_feed_latency_samples++ == 0) {
+        // first ball of the session, the default says nothing about this hopper
+        s_feed_latency_us = sample_us;
+        s_feed_latency_dev_us = sample_us / 4;
+        return;
+    }
+    s_feed_latency_us = (uint32_t)((int32_t)s_feed_latency_us + (err >> FEED_LATENCY_GAIN_SHIFT));
+    s_feed_latency_dev_us = (uint32_t)((int32_t)s_feed_latency_dev_us +
+        (((err < 0 ? -err : err) - (int32_t)s_feed_latency_dev_us) >> FEED_LATENCY_GAIN_SHIFT));
 }
 
-void request_feed(void)
+bool feed_wait_done(uint32_t timeout_ms, int64_t *release_us)
 {
-    s_feed_requested = true;
+    if (feed_events != NULL) {
+        EventBits_t bits = xEventGroupWaitBits(feed_events, FEED_DONE_BIT,
+                                               pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+        if (!(bits & FEED_DONE_BIT)) {
+            return false;
+        }
+    }
+    if (release_us) {
+        *release_us = s_feed_release_us;
+    }
+    return true;
 }
 
-bool is_horz_ready(void)
+uint32_t get_feed_latency_us(void)
 {
-    return horz_axis_state == AXIS_READY;
+    uint32_t staged = s_feed_staged_us;
+
+    return s_feed_latency_us > staged ? s_feed_latency_us - staged : 0;
 }
 
-bool is_elev_ready(void)
+void feed_set_prestage(bool enable)
 {
-    return elev_axis_state == ELEV_READY;
+    s_feed_prestage = enable;
+    ESP_LOGI(FTAG, "Pre-staging %s", enable ? "on" : "off");
 }
 
-bool is_feed_pending(void)
+bool is_feed_prestage(void)
+{
+    return s_feed_prestage;
+}
+
+bool is_feed_jammed(void)
+{
+    return s_feed_jammed;
+}
+
+uint32_t get_feed_jams(void)
+{
+    return s_feed_jams;
+}
+
+uint32_t get_feed_jams_cleared(void)
+{
+    return s_feed_jams_cleared;
+}
+
+bool is_horz_ready(void)
 {
-    return s_feed_requested;
+    return horz_axis_state == AXIS_READY;
 }
 
-static bool feed_requested(void)
+bool is_elev_ready(void)
 {
-    return s_feed_requested;
+    return elev_axis_state == ELEV_READY;
 }
 
-static void feed_acknowledged()
+bool is_feed_pending(void)
 {
-    s_feed_requested = false;
+    return feed_events != NULL && !(xEventGroupGetBits(feed_events) & FEED_DONE_BIT);
 }
 
 static bool feed_switch_pressed(void)
 {
-    return debounce_switch(FEED_SWITCH_GPIO);
+    // NC connected to gpio, will return true if switch is triggered and wire disconnected
+    // which makes consumption for motor stop downstream safer
+    if (feed_switch_input < 0) {
+        return gpio_get_level(FEED_SWITCH_GPIO) == 1;
+    }
+    return switch_input_level(feed_switch_input);
 }
 
 
+// edges stay enabled, the step engine watches the axis switches by interrupt
 static void limit_switch_init(uint32_t gpio_num)
 {
     gpio_config_t io_conf = {
         .pin_bit_mask = 1ULL << gpio_num,
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_ENABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
     };
     gpio_config(&io_conf);
 }
 
 static void feed_switch_init(void)
 {
-    limit_switch_init(FEED_SWITCH_GPIO);
+    feed_switch_queue = xQueueCreate(SWITCH_QUEUE_LEN, sizeof(switch_event_t));
+    feed_switch_input = switch_input_add(FEED_SWITCH_GPIO, SWITCH_DEBOUNCE_US,
+                                         feed_switch_queue);
+    if (feed_switch_input < 0) {
+        ESP_LOGE(FTAG, "Feed switch interrupt unavailable, polling it");
+        limit_switch_init(FEED_SWITCH_GPIO);
+    }
 }
 
 static void pwm_init(gpio_num_t en_gpio, gpio_num_t pwm_gpio, gpio_num_t channel)
@@ -268,25 +910,85 @@ static void pwm_init(gpio_num_t en_gpio, gpio_num_t pwm_gpio, gpio_num_t channel
     };
     ESP_ERROR_CHECK(ledc_channel_config(&channel_cfg));
 
+    if (!pwm_fade_installed) {
+        ESP_ERROR_CHECK(ledc_fade_func_install(0));
+        pwm_fade_installed = true;
+    }
+
     ESP_LOGI(TAG, "PWM initialized");
 }
 
-static void pwm_start(gpio_num_t channel, uint32_t duty)
+static void pwm_set_ramp(ledc_channel_t channel, uint32_t ramp_ms)
+{
+    pwm_ramp_ms[channel] = ramp_ms;
+}
+
+// sets up a fade to duty without starting it, 0 ms applies the duty at once
+static void pwm_fade_prepare(ledc_channel_t channel, uint32_t duty, uint32_t ramp_ms)
 {
     esp_err_t ret;
-    ret = ledc_set_duty(PWM_LEDC_MODE, channel, duty);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "pwm_start ledc_set_duty failed: %s", esp_err_to_name(ret));
+
+    ledc_fade_stop(PWM_LEDC_MODE, channel);
+    if (ramp_ms == 0) {
+        ret = ledc_set_duty(PWM_LEDC_MODE, channel, duty);
+    } else {
+        ret = ledc_set_fade_with_time(PWM_LEDC_MODE, channel, duty, ramp_ms);
     }
-    ret = ledc_update_duty(PWM_LEDC_MODE, channel);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "pwm_start ledc_update_duty failed: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "pwm fade to %lu on channel %d failed: %s",
+                 duty, channel, esp_err_to_name(ret));
+    }
+}
+
+static void pwm_fade_run(ledc_channel_t channel, uint32_t ramp_ms)
+{
+    if (ramp_ms == 0) {
+        ledc_update_duty(PWM_LEDC_MODE, channel);
+    } else {
+        ledc_fade_start(PWM_LEDC_MODE, channel, LEDC_FADE_NO_WAIT);
     }
-    ESP_LOGI(TAG, "pwm_start: duty=%d on channel %d", duty, channel);
 }
 
+/*
+ * Ramps two channels to their duties in lockstep, both fade over the longer
+ * of their ramp times and start back to back. The fade engine steps the duty,
+ * nothing to do for the CPU. Returns the ramp time.
+ */
+static uint32_t pwm_start_pair(ledc_channel_t a, uint32_t duty_a,
+                               ledc_channel_t b, uint32_t duty_b)
+{
+    uint32_t ramp_ms = pwm_ramp_ms[a] > pwm_ramp_ms[b] ? pwm_ramp_ms[a] : pwm_ramp_ms[b];
+
+    pwm_fade_prepare(a, duty_a, ramp_ms);
+    pwm_fade_prepare(b, duty_b, ramp_ms);
+    pwm_fade_run(a, ramp_ms);
+    pwm_fade_run(b, ramp_ms);
+    ESP_LOGI(TAG, "pwm_start_pair: duty=%lu/%lu on channels %d/%d over %lu ms",
+             duty_a, duty_b, a, b, ramp_ms);
+    return ramp_ms;
+}
+
+// duty update without logging, for the wheel loop
+static void pwm_set_duty(gpio_num_t channel, uint32_t duty)
+{
+    ledc_set_duty(PWM_LEDC_MODE, channel, duty);
+    ledc_update_duty(PWM_LEDC_MODE, channel);
+}
+
+// ramps to duty over the ramp time of the channel
+static void pwm_start(gpio_num_t channel, uint32_t duty)
+{
+    uint32_t ramp_ms = pwm_ramp_ms[channel];
+
+    pwm_fade_prepare(channel, duty, ramp_ms);
+    pwm_fade_run(channel, ramp_ms);
+    ESP_LOGI(TAG, "pwm_start: duty=%d on channel %d over %lu ms", duty, channel, ramp_ms);
+}
+
+// stops at once, a running fade is cancelled
 static void pwm_stop(gpio_num_t channel)
 {
+    ledc_fade_stop(PWM_LEDC_MODE, channel);
     ledc_set_duty(PWM_LEDC_MODE, channel, 0);
     ledc_update_duty(PWM_LEDC_MODE, channel);
 }
@@ -295,6 +997,7 @@ static void pwm_stop(gpio_num_t channel)
 void feed_motor_init(void)
 {
     pwm_init(FEED_EN_GPIO, FEED_PWM_GPIO, FEED_LEDC_CHANNEL);
+    pwm_set_ramp(FEED_LEDC_CHANNEL, FEED_RAMP_MS);
 }
 
 static void feed_motor_start(void)
@@ -307,17 +1010,62 @@ static void feed_motor_stop(void)
     pwm_stop(FEED_LEDC_CHANNEL);
 }
 
+/*
+ * A feed attempt timed out. The feeder only turns one way, so it backs off by
+ * stopping for a moment to let the ball settle and then tries again. Once the
+ * retries are used up the feed is given up: waiters are released, the program
+ * paused and the app told through the status.
+ */
+static feed_state_t feed_jam(feed_state_t state, int64_t *state_start_us)
+{
+    feed_motor_stop();
+    *state_start_us = esp_timer_get_time();
+    // counted once per feed, like the jams cleared
+    if (feed_attempt == 0) {
+        s_feed_jams++;
+    }
+    feed_jam_state = state;
+
+    if (feed_attempt < FEED_JAM_RETRIES) {
+        feed_attempt++;
+        ESP_LOGW(FTAG, "Jam, backing off for retry %lu of %d", feed_attempt, FEED_JAM_RETRIES);
+        return FEED_BACKOFF;
+    }
+
+    ESP_LOGE(FTAG, "Jam not cleared after %d retries, pausing", FEED_JAM_RETRIES);
+    feed_attempt = 0;
+    s_feed_staged_us = 0;
+    s_feed_jammed = true;
+    xEventGroupSetBits(feed_events, FEED_DONE_BIT);
+    pause_frankenshot_feeding();
+    send_frankenshot_status_indication();
+    return FEED_ERROR;
+}
+
 void feed_task(void *arg)
 {
     feed_state_t state = FEED_IDLE;
     feed_state_t last_state = -1;
     int64_t state_start_us = 0;
+    int64_t stage_end_us = 0;
+    bool staged_at_switch = false;
 
     feed_switch_init();
     feed_motor_init();
+    feed_task_handle = xTaskGetCurrentTaskHandle();
+    esp_timer_create_args_t timer_args = {
+        .callback = feed_start_fire,
+        .name = "feed_start",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &feed_start_timer));
+    feed_events = xEventGroupCreate();
+    xEventGroupSetBits(feed_events, FEED_DONE_BIT);
 
     while (1) {
-        bool sw = feed_switch_pressed();
+        switch_event_t ev;
+        bool sw;
+        int64_t sw_us;
+        uint32_t timeout_ms = feed_attempt ? FEED_RETRY_TIMEOUT_MS : FEED_TIMEOUT_MS;
 
         // State entry diagnostics
         if (state != last_state) {
@@ -338,6 +1086,14 @@ void feed_task(void *arg)
                 ESP_LOGI(FTAG, "State: WAIT_RELEASE");
                 break;
 
+            case FEED_STAGING:
+                ESP_LOGI(FTAG, "State: STAGING");
+                break;
+
+            case FEED_BACKOFF:
+                ESP_LOGW(FTAG, "State: BACKOFF");
+                break;
+
             case FEED_ERROR:
                 ESP_LOGE(FTAG, "State: ERROR");
                 break;
@@ -345,26 +1101,66 @@ void feed_task(void *arg)
             last_state = state;
         }
 
+        if (state == FEED_IDLE || state == FEED_ERROR) {
+            // asleep until a request, edges meanwhile are of no interest
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            if (feed_switch_input >= 0) {
+                xQueueReset(feed_switch_queue);
+            }
+            sw = feed_switch_pressed();
+            sw_us = esp_timer_get_time();
+        } else {
+            // an edge wakes the task at once and carries the time it happened at,
+            // otherwise it wakes when the feed times out or staging or backoff is done
+            int64_t end_us = state == FEED_STAGING ? stage_end_us
+                           : state == FEED_BACKOFF ? state_start_us + FEED_BACKOFF_MS * 1000LL
+                           : state_start_us + timeout_ms * 1000LL;
+            int64_t left_ms = (end_us - esp_timer_get_time()) / 1000;
+            TickType_t wait = left_ms > 0 ? pdMS_TO_TICKS(left_ms) + 1 : 0;
+
+            if (feed_switch_input < 0) {
+                // no interrupt, the pin is sampled every FEED_POLL_MS
+                vTaskDelay(pdMS_TO_TICKS(FEED_POLL_MS));
+                sw = feed_switch_pressed();
+                sw_us = esp_timer_get_time();
+            } else if (xQueueReceive(feed_switch_queue, &ev, wait) == pdTRUE) {
+                sw = ev.level;
+                sw_us = ev.time_us;
+            } else {
+                sw = feed_switch_pressed();
+                sw_us = esp_timer_get_time();
+            }
+        }
+
         switch (state) {
 
+        case FEED_ERROR:
+            // a new request, e.g. resuming once the jam has been cleared by hand
+            s_feed_jammed = false;
+            send_frankenshot_status_indication();
+            /* fall through */
         case FEED_IDLE:
-            if (feed_requested()) {
-                ESP_LOGI(FTAG, "Feed requested");
-                feed_motor_start();
-                state_start_us = esp_timer_get_time();
+            ESP_LOGI(FTAG, "Feed requested");
+            feed_motor_start();
+            // a staged ball counts from when staging began
+            state_start_us = esp_timer_get_time() - s_feed_staged_us;
+            s_feed_staged_us = 0;
 
+            if (staged_at_switch && sw) {
+                state = FEED_WAIT_RELEASE;
+            } else {
                 state = sw ? FEED_CLEAR_SWITCH : FEED_RUNNING;
             }
+            staged_at_switch = false;
             break;
 
         case FEED_CLEAR_SWITCH:
             if (!sw) {
                 ESP_LOGI(FTAG, "Switch cleared");
                 state = FEED_RUNNING;
-            } else if (timed_out(state_start_us, FEED_TIMEOUT_MS)) {
+            } else if (timed_out(state_start_us, timeout_ms)) {
                 ESP_LOGE(FTAG, "Timeout clearing switch");
-                feed_motor_stop();
-                state = FEED_ERROR;
+                state = feed_jam(state, &state_start_us);
             }
             break;
 
@@ -372,29 +1168,85 @@ void feed_task(void *arg)
             if (sw) {
                 ESP_LOGI(FTAG, "Switch hit");
                 state = FEED_WAIT_RELEASE;
-            } else if (timed_out(state_start_us, FEED_TIMEOUT_MS)) {
+            } else if (timed_out(state_start_us, timeout_ms)) {
                 ESP_LOGE(FTAG, "Timeout waiting for switch");
-                feed_motor_stop();
-                state = FEED_ERROR;
+                state = feed_jam(state, &state_start_us);
             }
             break;
 
         case FEED_WAIT_RELEASE:
             if (!sw) {
-                ESP_LOGI(FTAG, "Switch released");
+                uint32_t latency_us = (uint32_t)(sw_us - state_start_us);
+
+                s_feed_release_us = sw_us;
+                if (feed_attempt) {
+                    // the time says nothing about a normal feed
+                    ESP_LOGI(FTAG, "Jam cleared on retry %lu", feed_attempt);
+                    s_feed_jams_cleared++;
+                    feed_attempt = 0;
+                } else {
+                    feed_learn_latency(latency_us);
+                    ESP_LOGI(FTAG, "Switch released %lu ms after the start, learned %lu +- %lu ms",
+                             latency_us / 1000, s_feed_latency_us / 1000,
+                             s_feed_latency_dev_us / 1000);
+                }
+                xEventGroupSetBits(feed_events, FEED_DONE_BIT);
+                if (s_feed_prestage) {
+                    // the motor runs on towards the next ball
+                    state_start_us = sw_us;
+                    // a fast ball comes in up to about twice the deviation early
+                    int64_t lead_us = 2LL * s_feed_latency_dev_us;
+                    if (lead_us < FEED_STAGE_LEAD_MS * 1000LL) {
+                        lead_us = FEED_STAGE_LEAD_MS * 1000LL;
+                    }
+                    stage_end_us = sw_us + s_feed_latency_us - lead_us;
+                    state = FEED_STAGING;
+                } else {
+                    feed_motor_stop();
+                    state = FEED_IDLE;
+                }
+            } else if (timed_out(state_start_us, timeout_ms)) {
+                ESP_LOGE(FTAG, "Timeout waiting for release");
+                state = feed_jam(state, &state_start_us);
+            }
+            break;
+
+        case FEED_STAGING:
+            if (sw || esp_timer_get_time() >= stage_end_us) {
+                int64_t stop_us = sw ? sw_us : esp_timer_get_time();
+
                 feed_motor_stop();
-                feed_acknowledged();
+                s_feed_staged_us = (uint32_t)(stop_us - state_start_us);
+                // came early, the next feed only has to let it go
+                staged_at_switch = sw;
+                ESP_LOGI(FTAG, "Staged after %lu ms%s", s_feed_staged_us / 1000,
+                         sw ? ", ball on the switch" : "");
                 state = FEED_IDLE;
             }
             break;
 
-        case FEED_ERROR:
-            feed_motor_stop();
-            // Stay here until reset / manual clear
+        case FEED_BACKOFF:
+            if (feed_jam_state == FEED_WAIT_RELEASE && !sw) {
+                // the ball rolled off the switch on its own, the feed is done
+                ESP_LOGI(FTAG, "Switch released during backoff, jam cleared");
+                s_feed_release_us = sw_us;
+                s_feed_jams_cleared++;
+                feed_attempt = 0;
+                xEventGroupSetBits(feed_events, FEED_DONE_BIT);
+                state = FEED_IDLE;
+            } else if (timed_out(state_start_us, FEED_BACKOFF_MS)) {
+                feed_motor_start();
+                state_start_us = esp_timer_get_time();
+                // a ball that made it to the switch meanwhile only needs letting go
+                if (sw) {
+                    state = feed_jam_state == FEED_CLEAR_SWITCH ? FEED_CLEAR_SWITCH
+                                                                : FEED_WAIT_RELEASE;
+                } else {
+                    state = FEED_RUNNING;
+                }
+            }
             break;
         }
-
-        vTaskDelay(pdMS_TO_TICKS(FEED_POLL_MS));
     }
 }
 
@@ -404,84 +1256,447 @@ static void elev_bottom_motor_pwm_init(void)
     pwm_init(ELEV_BOTTOM_EN_GPIO, ELEV_BOTTOM_PWM_GPIO, ELEV_BOTTOM_LEDC_CHANNEL);
 }
 
-static void elev_bottom_motor_start(uint32_t duty)
-{
-    pwm_start(ELEV_BOTTOM_LEDC_CHANNEL, duty);
-}
-
-static void elev_bottom_motor_stop(void)
-{
-    pwm_stop(ELEV_BOTTOM_LEDC_CHANNEL);
-}
-
 static void elev_top_motor_pwm_init(void)
 {
     pwm_init(ELEV_TOP_EN_GPIO, ELEV_TOP_PWM_GPIO, ELEV_TOP_LEDC_CHANNEL);
-}   
-
-static void elev_top_motor_start(uint32_t duty)
-{
-    pwm_start(ELEV_TOP_LEDC_CHANNEL, duty);
-}
-
-static void elev_top_motor_stop(void)
-{
-    pwm_stop(ELEV_TOP_LEDC_CHANNEL);
 }
 
 void elev_motors_init(void)
 {
     elev_top_motor_pwm_init();
     elev_bottom_motor_pwm_init();
+    pwm_set_ramp(ELEV_TOP_LEDC_CHANNEL, WHEEL_RAMP_MS);
+    pwm_set_ramp(ELEV_BOTTOM_LEDC_CHANNEL, WHEEL_RAMP_MS);
+
+    if (wheel_mutex == NULL) {
+        wheel_mutex = xSemaphoreCreateMutex();
+        wheel_events = xEventGroupCreate();
+    }
+    wheels[0] = (wheel_t){
+        .channel = ELEV_TOP_LEDC_CHANNEL,
+        .sense = motor_sense_add(ELEV_TOP_IS_GPIO),
+    };
+    wheels[1] = (wheel_t){
+        .channel = ELEV_BOTTOM_LEDC_CHANNEL,
+        .sense = motor_sense_add(ELEV_BOTTOM_IS_GPIO),
+    };
+    if (wheels[0].sense < 0 || wheels[1].sense < 0) {
+        ESP_LOGW(WTAG, "Current sense unavailable, wheels run open loop");
+    }
+    wheel_cal_init(WHEEL_EMF_FULL_MV, WHEEL_EMF_MAX_MV, ELEV_SPIN_DIVISOR);
+
+    supply_sense = motor_sense_add(SUPPLY_SENSE_GPIO);
+    if (supply_sense < 0) {
+        ESP_LOGW(WTAG, "Supply sense unavailable, assuming %d mV", WHEEL_SUPPLY_MV);
+    }
 }
 
 void elev_motors_stop(void)
 {
-    elev_top_motor_stop();
-    elev_bottom_motor_stop();
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    for (int i = 0; i < 2; i++) {
+        wheels[i].target_mv = 0;
+        wheels[i].emf_mv = 0;
+        wheels[i].integral = 0;
+        wheels[i].duty = 0;
+        wheels[i].settled = 0;
+        wheels[i].phase = WHEEL_TRACK;
+        pwm_stop(wheels[i].channel);
+    }
+    xEventGroupClearBits(wheel_events, WHEELS_READY_BIT);
+    xSemaphoreGive(wheel_mutex);
+}
+
+/*
+ * Picks how a wheel gets to a new target. Big steps up overdrive at full duty
+ * and big steps down coast at zero duty, both end short of the target and the
+ * PI loop settles the rest. Small steps start from the open loop duty.
+ */
+static void wheel_plan(wheel_t *w, int64_t now_us)
+{
+    int32_t change = w->target_mv - w->emf_mv;
+
+    w->settled = 0;
+    if (change >= WHEEL_BOOST_MIN_MV) {
+        w->phase = WHEEL_BOOST;
+        w->phase_end_us = now_us + (int64_t)(change - WHEEL_BOOST_EXIT_MV) * 1000 /
+                                   WHEEL_BOOST_MV_PER_MS;
+        w->duty = ELEV_MOTOR_MAX_DUTY;
+    } else if (change <= -WHEEL_BOOST_MIN_MV) {
+        w->phase = WHEEL_COAST;
+        w->phase_end_us = now_us + (int64_t)(-change - WHEEL_BOOST_EXIT_MV) * 1000 /
+                                   WHEEL_COAST_MV_PER_MS;
+        w->duty = 0;
+    } else {
+        w->phase = WHEEL_TRACK;
+        w->duty = (uint32_t)((int64_t)w->target_mv * ELEV_MOTOR_MAX_DUTY / supply_mv);
+        if (w->duty > ELEV_MOTOR_MAX_DUTY) {
+            w->duty = ELEV_MOTOR_MAX_DUTY;
+        }
+    }
+    if (w->phase != WHEEL_TRACK) {
+        ESP_LOGI(WTAG, "%s %ld -> %ld mV", w->phase == WHEEL_BOOST ? "Boost" : "Coast",
+                 w->emf_mv, w->target_mv);
+    }
 }
 
-void elev_motors_start(uint32_t speed, uint32_t spin)
+// boost and coast phases, returns true once the PI loop takes over
+static bool wheel_transient(wheel_t *w, bool sensed)
 {
-    if (spin > 10) {
-        ESP_LOGE(TAG, "elev_motors_start: invalid spin %d", spin);
-        return;
+    int64_t now = esp_timer_get_time();
+    bool done;
+
+    if (w->phase == WHEEL_BOOST && sensed) {
+        // an out of reach target hands over to the PI loop after the margin
+        done = w->emf_mv >= w->target_mv - WHEEL_BOOST_EXIT_MV ||
+               now >= w->phase_end_us + WHEEL_BOOST_MARGIN_MS * 1000LL;
+    } else if (w->phase == WHEEL_BOOST) {
+        done = now >= w->phase_end_us;
+    } else {
+        // no current at zero duty, a coast always goes by time
+        done = now >= w->phase_end_us;
     }
-    if (speed < 1 || speed > 10) {
-        ESP_LOGE(TAG, "elev_motors_start: invalid speed %d", speed);
-        return;
+    if (!done) {
+        return false;
     }
 
-    
-    int32_t base = (speed * ELEV_MOTOR_MAX_DUTY) / 10;
-
-    /* Centered spin: -5 … +5 */
-    int32_t spin_offset = (int32_t)spin - 5;
+    if (w->phase == WHEEL_COAST || !sensed) {
+        // the estimate was not followed meanwhile, assume the plan held
+        w->emf_mv = w->target_mv + (w->phase == WHEEL_BOOST ? -1 : 1) * WHEEL_BOOST_EXIT_MV;
+    }
+    w->phase = WHEEL_TRACK;
+    w->integral = 0;
+    return true;
+}
+
+// new back-EMF targets, both wheels ramp over to them together
+static void wheels_set_targets(int32_t top_mv, int32_t bottom_mv)
+{
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    if (wheels[0].target_mv != top_mv || wheels[1].target_mv != bottom_mv) {
+        ESP_LOGI(TAG, "Elev motors: top=%ld bottom=%ld mV", top_mv, bottom_mv);
+        wheels[0].target_mv = top_mv;
+        wheels[1].target_mv = bottom_mv;
+        wheel_start_us = esp_timer_get_time();
+        for (int i = 0; i < 2; i++) {
+            wheel_plan(&wheels[i], wheel_start_us);
+        }
+        // both wheels ramp together, no current spike from starting them at once
+        uint32_t ramp_ms = pwm_start_pair(wheels[0].channel, wheels[0].duty,
+                                          wheels[1].channel, wheels[1].duty);
+        for (int i = 0; i < 2; i++) {
+            wheels[i].fade_end_us = wheel_start_us + (int64_t)ramp_ms * 1000;
+            wheels[i].phase_end_us += (int64_t)ramp_ms * 1000;
+        }
+        wheel_unready_us = wheel_start_us;
+        xEventGroupClearBits(wheel_events, WHEELS_READY_BIT);
+    }
+    xSemaphoreGive(wheel_mutex);
+}
 
-    int32_t delta = (base * spin_offset) / ELEV_SPIN_DIVISOR;
+void elev_motors_start(uint32_t speed, uint32_t spin)
+{
+    if (speed < 1 || speed > 10) {
+        ESP_LOGE(TAG, "elev_motors_start: invalid speed %lu", speed);
+        return;
+    }
+    elev_motors_start_centi(speed * 100, spin);
+}
 
-    int32_t top_duty    = base + delta;
-    int32_t bottom_duty = base - delta;
+void elev_motors_start_centi(uint32_t speed_centi, uint32_t spin)
+{
+    if (spin > 10 || speed_centi < 100 || speed_centi > 1000) {
+        // e.g. speed 0 from the app, the wheels stay off and nothing waits on them
+        ESP_LOGE(TAG, "elev_motors_start: invalid speed %lu.%02lu spin %lu, wheels off",
+                 speed_centi / 100, speed_centi % 100, spin);
+        elev_motors_stop();
+        xEventGroupSetBits(wheel_events, WHEELS_READY_BIT);
+        return;
+    }
 
-    /* Clamp */
-    if (top_duty > ELEV_MOTOR_MAX_DUTY) top_duty = ELEV_MOTOR_MAX_DUTY;
-    if (top_duty < 0) top_duty = 0;
+    int32_t top_mv, bottom_mv;
+    wheel_cal_lookup(speed_centi, spin, &top_mv, &bottom_mv);
 
-    if (bottom_duty > ELEV_MOTOR_MAX_DUTY) bottom_duty = ELEV_MOTOR_MAX_DUTY;
-    if (bottom_duty < 0) bottom_duty = 0;
+    wheel_cal_active = false;
+    wheels_set_targets(top_mv, bottom_mv);
+}
 
-    ESP_LOGI(TAG,
-        "Elev motors: speed=%lu spin=%lu base=%ld offset=%ld top=%ld bottom=%ld",
-        speed, spin, base, spin_offset, top_duty, bottom_duty
-    );
+/*
+ * Time the wheels take from their current targets to settle on a new speed,
+ * from the fade, the boost or coast rates and the settle loops. Lets the
+ * program start a spin-up early enough.
+ */
+uint32_t elev_motors_spinup_ms(uint32_t speed_centi, uint32_t spin)
+{
+    int32_t top_mv, bottom_mv;
+    uint32_t worst = 0;
+
+    wheel_cal_lookup(speed_centi, spin, &top_mv, &bottom_mv);
+
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    int32_t changes[2] = { top_mv - wheels[0].target_mv, bottom_mv - wheels[1].target_mv };
+    xSemaphoreGive(wheel_mutex);
+
+    for (int i = 0; i < 2; i++) {
+        uint32_t ms = 0;
+        if (changes[i] >= WHEEL_BOOST_MIN_MV) {
+            ms = (changes[i] - WHEEL_BOOST_EXIT_MV) / WHEEL_BOOST_MV_PER_MS;
+        } else if (changes[i] <= -WHEEL_BOOST_MIN_MV) {
+            ms = (-changes[i] - WHEEL_BOOST_EXIT_MV) / WHEEL_COAST_MV_PER_MS;
+        }
+        if (changes[i] != 0) {
+            ms += WHEEL_RAMP_MS + WHEEL_READY_LOOPS * WHEEL_LOOP_MS;
+        }
+        if (ms > worst) {
+            worst = ms;
+        }
+    }
+    return worst;
+}
+
+// calibration mode, runs the wheels on the entry so test balls can be fed
+bool elev_motors_calibrate(uint32_t speed, uint32_t spin,
+                           uint32_t top_mv, uint32_t bottom_mv)
+{
+    wheel_cal_entry_t entry = {
+        .top_mv = top_mv > UINT16_MAX ? UINT16_MAX : top_mv,
+        .bottom_mv = bottom_mv > UINT16_MAX ? UINT16_MAX : bottom_mv,
+    };
+
+    if (!wheel_cal_set(speed, spin, &entry)) {
+        ESP_LOGE(WTAG, "Calibration entry out of range");
+        return false;
+    }
+    wheel_cal_active = true;
+    wheels_set_targets(entry.top_mv, entry.bottom_mv);
+    return true;
+}
+
+bool elev_motors_cal_save(void)
+{
+    wheel_cal_active = false;
+    return wheel_cal_save() == ESP_OK;
+}
+
+bool elev_motors_cal_reset(void)
+{
+    wheel_cal_active = false;
+    return wheel_cal_reset() == ESP_OK;
+}
+
+/*
+ * Wheels while the program is paused, called periodically with the time since
+ * the pause. Keeping them going means a resume or a manual ball does not wait
+ * for a spin-up.
+ */
+void elev_motors_idle(uint32_t paused_ms)
+{
+    const frankenshot_idle_t *idle = get_frankenshot_idle();
+
+    if (wheel_cal_active) {
+        return;
+    }
+    if (idle->policy == FRANKENSHOT_IDLE_STOP ||
+        (idle->timeout_s > 0 && paused_ms >= (uint32_t)idle->timeout_s * 1000)) {
+        elev_motors_stop();
+        return;
+    }
+    if (idle->policy != FRANKENSHOT_IDLE_REDUCED) {
+        return;
+    }
+
+    xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+    int32_t fastest = wheels[0].target_mv > wheels[1].target_mv ?
+                      wheels[0].target_mv : wheels[1].target_mv;
+    xSemaphoreGive(wheel_mutex);
+
+    // only ever slows down, stopped wheels stay stopped
+    if (fastest > (int32_t)(idle->speed * WHEEL_EMF_FULL_MV) / 10) {
+        elev_motors_start(idle->speed, 5);
+    }
+}
+
+bool wheels_wait_ready(uint32_t timeout_ms)
+{
+    EventBits_t bits = xEventGroupWaitBits(wheel_events, WHEELS_READY_BIT,
+                                           pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & WHEELS_READY_BIT) != 0;
+}
+
+/*
+ * Back-EMF of a wheel from the last loop. The IS output follows the high side
+ * current, which only flows during the on phase, so the averaged reading is
+ * the winding current scaled by the duty.
+ */
+static bool wheel_estimate(wheel_t *w)
+{
+    if (w->sense < 0 || w->duty < WHEEL_MIN_SENSE_DUTY) {
+        return false;
+    }
+    int32_t is_mv = motor_sense_read_mv(w->sense, WHEEL_SENSE_SAMPLES);
+    if (is_mv < 0) {
+        return false;
+    }
+
+    int64_t avg_ma = (int64_t)is_mv * WHEEL_IS_RATIO / WHEEL_IS_RESISTOR_OHM;
+    int64_t motor_ma = avg_ma * ELEV_MOTOR_MAX_DUTY / w->duty;
+    int32_t applied_mv = (int32_t)((int64_t)supply_mv * w->duty / ELEV_MOTOR_MAX_DUTY);
+    int32_t emf_mv = applied_mv - (int32_t)(motor_ma * WHEEL_MOTOR_R_MOHM / 1000);
+
+    w->emf_mv += (emf_mv - w->emf_mv) >> WHEEL_EMF_FILTER_SHIFT;
+    return true;
+}
+
+// one PI step, returns true if the wheel is at speed
+static bool wheel_update(wheel_t *w)
+{
+    const float dt = WHEEL_LOOP_MS / 1000.0f;
+    float feed_forward = (float)w->target_mv * ELEV_MOTOR_MAX_DUTY / supply_mv;
+
+    if (esp_timer_get_time() < w->fade_end_us) {
+        return false;
+    }
 
-    elev_top_motor_start((uint32_t)top_duty);
-    elev_bottom_motor_start((uint32_t)bottom_duty);
+    bool sensed = wheel_estimate(w);
+
+    if (w->phase != WHEEL_TRACK && !wheel_transient(w, sensed)) {
+        return false;
+    }
+    if (!sensed) {
+        // nothing to close the loop on, run on the open loop duty, which the
+        // wheel has reached once the fade is done
+        w->duty = (uint32_t)feed_forward;
+        w->emf_mv = w->target_mv;
+        pwm_set_duty(w->channel, w->duty);
+        return true;
+    }
+
+    float error = (float)(w->target_mv - w->emf_mv);
+    float out = feed_forward + WHEEL_KP * error + w->integral;
+
+    // integrate only while the output is not pinned, no wind up
+    if ((out < ELEV_MOTOR_MAX_DUTY || error < 0) && (out > 0 || error > 0)) {
+        w->integral += WHEEL_KI * error * dt;
+        out = feed_forward + WHEEL_KP * error + w->integral;
+    }
+    if (out > ELEV_MOTOR_MAX_DUTY) out = ELEV_MOTOR_MAX_DUTY;
+    if (out < 0) out = 0;
+
+    w->duty = (uint32_t)out;
+    pwm_set_duty(w->channel, w->duty);
+
+    if (error < WHEEL_READY_TOL_MV && error > -WHEEL_READY_TOL_MV) {
+        w->settled++;
+    } else {
+        w->settled = 0;
+    }
+    return w->settled >= WHEEL_READY_LOOPS;
+}
+
+uint32_t get_supply_mv(void)
+{
+    return supply_mv;
+}
+
+uint8_t get_battery_pct(void)
+{
+    uint32_t mv = supply_mv;
+
+    if (mv <= BATTERY_EMPTY_MV) {
+        return 0;
+    }
+    if (mv >= BATTERY_FULL_MV) {
+        return 100;
+    }
+    return (uint8_t)((mv - BATTERY_EMPTY_MV) * 100 / (BATTERY_FULL_MV - BATTERY_EMPTY_MV));
+}
+
+bool is_battery_low(void)
+{
+    return battery_low;
+}
+
+/*
+ * Reads the rail the wheels run from. As the battery sags the same duty gives
+ * less voltage, the wheel loop divides by the reading so the motors see the
+ * same effective voltage all session long.
+ */
+static void supply_update(void)
+{
+    int32_t pin_mv = motor_sense_read_mv(supply_sense, WHEEL_SENSE_SAMPLES);
+    int32_t mv = pin_mv * SUPPLY_DIVIDER_RATIO;
+
+    if (pin_mv < 0 || mv < SUPPLY_MIN_MV) {
+        return;
+    }
+    supply_mv += (mv - (int32_t)supply_mv) >> SUPPLY_FILTER_SHIFT;
+
+    uint8_t pct = get_battery_pct();
+    bool low = battery_low ? pct < BATTERY_LOW_PCT + BATTERY_LOW_HYST_PCT
+                           : pct < BATTERY_LOW_PCT;
+    if (low != battery_low) {
+        battery_low = low;
+        if (low) {
+            ESP_LOGW(WTAG, "Battery low: %lu mV (%u%%)", supply_mv, pct);
+        } else {
+            ESP_LOGI(WTAG, "Battery ok: %lu mV (%u%%)", supply_mv, pct);
+        }
+        send_frankenshot_status_indication();
+    }
 }
 
-static bool horz_switch_pressed(void)
+void wheel_task(void *arg)
 {
-    return debounce_switch(HORZ_SWITCH_GPIO);
+    TickType_t last_wake = xTaskGetTickCount();
+    uint32_t loops = 0;
+
+    if (supply_sense >= 0) {
+        // start from a real reading rather than crawling up from nominal
+        int32_t pin_mv = motor_sense_read_mv(supply_sense, WHEEL_SENSE_SAMPLES);
+        if (pin_mv * SUPPLY_DIVIDER_RATIO >= SUPPLY_MIN_MV) {
+            supply_mv = pin_mv * SUPPLY_DIVIDER_RATIO;
+        }
+    }
+
+    while (1) {
+        if (supply_sense >= 0 && loops++ % SUPPLY_SENSE_LOOPS == 0) {
+            supply_update();
+        }
+
+        xSemaphoreTake(wheel_mutex, portMAX_DELAY);
+        bool running = false;
+        bool ready = true;
+        for (int i = 0; i < 2; i++) {
+            if (wheels[i].target_mv == 0) {
+                continue;
+            }
+            running = true;
+            ready &= wheel_update(&wheels[i]);
+        }
+        if (running && ready) {
+            wheel_unready_us = -1;
+        } else if (running) {
+            // a wheel lost speed, e.g. to the last ball, the next waits for it
+            if (wheel_unready_us < 0) {
+                wheel_unready_us = esp_timer_get_time();
+            }
+            if (timed_out(wheel_unready_us, WHEEL_SETTLE_TIMEOUT_MS)) {
+                if (!(xEventGroupGetBits(wheel_events) & WHEELS_READY_BIT)) {
+                    ESP_LOGW(WTAG, "Not settled after %d ms, feeding anyway",
+                             WHEEL_SETTLE_TIMEOUT_MS);
+                }
+                ready = true;
+            } else {
+                xEventGroupClearBits(wheel_events, WHEELS_READY_BIT);
+            }
+        }
+        if (running && ready) {
+            xEventGroupSetBits(wheel_events, WHEELS_READY_BIT);
+        }
+        xSemaphoreGive(wheel_mutex);
+
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(WHEEL_LOOP_MS));
+    }
 }
 
 static void horz_switch_init(void)
@@ -521,13 +1736,9 @@ static void horz_counterclockwise(void)
     gpio_set_level(HORZ_DIR_GPIO, horz_dir);
 }
 
-static void horz_count_step(void)
+static int8_t horz_step_sign(void)
 {
-    if (horz_dir == 0) {
-        horz_step_counter++;
-    } else {
-        horz_step_counter--;
-    }
+    return horz_dir == 0 ? 1 : -1;
 }
 
 static void stepper_init(uint32_t step_gpio, uint32_t dir_gpio, uint32_t en_gpio)
@@ -549,44 +1760,151 @@ static void horz_stepper_init(void)
         HORZ_DIR_GPIO,
         HORZ_EN_GPIO
     );
+    axes_sync_init();
+    if (horz_queue == NULL) {
+        horz_queue = xQueueCreate(AXIS_QUEUE_LEN, sizeof(axis_cmd_t));
+    }
+    horz_max_sps = tuned_max_sps("horz_sps", &horz_profile, HORZ_TUNE_MAX_SPS);
+    step_profile_t profile = profile_at_speed(&horz_profile, horz_max_sps);
+    step_engine_axis_init(STEP_AXIS_HORZ, HORZ_STEP_GPIO, &profile,
+                          axis_step_done, horz_queue);
+    step_engine_watch(STEP_AXIS_HORZ, HORZ_SWITCH_GPIO, false,
+                      axis_index_seen, horz_queue);
+
+    const crank_geometry_t geo = {
+        .crank_radius = HORZ_CRANK_RADIUS_MM,
+        .rod_length = HORZ_ROD_LENGTH_MM,
+        .pivot_arm = HORZ_PIVOT_ARM_MM,
+    };
+    crank_build_aim_table(&geo, horz_total_steps, horz_aim_steps, HORZ_AIM_POSITIONS);
 
     horz_driver_disable();
     horz_clockwise();
 }
 
-static void horz_step_pulse(void)
+static int32_t horz_rev_steps(void)
 {
-    gpio_set_level(HORZ_STEP_GPIO, 1);
-    esp_rom_delay_us(HORZ_STEP_DELAY_US); 
-    gpio_set_level(HORZ_STEP_GPIO, 0);
-    esp_rom_delay_us(HORZ_STEP_DELAY_US);
+    return 2 * horz_total_steps;
 }
 
-static void horz_move_to_step(int32_t pos)
+// crank position folded into one turn, 0..horz_rev_steps()-1
+static int32_t horz_wrap(int32_t pos)
 {
-    if (pos == horz_step_counter) {
-        ESP_LOGI(HTAG, "Already at position %ld", pos);
-        return;
+    int32_t rev = horz_rev_steps();
+    int32_t wrapped = pos % rev;
+
+    return wrapped < 0 ? wrapped + rev : wrapped;
+}
+
+/*
+ * The axis is cyclic, every aim is reached at a crank position on the way out
+ * and its mirror on the way back, and the crank may keep turning through the
+ * index instead of reversing. Returns the closest of these from `from`, in
+ * the unwrapped frame of the step engine position.
+ */
+static int32_t horz_path_target(int32_t from, int32_t pos)
+{
+    int32_t rev = horz_rev_steps();
+    int32_t candidates[2] = { pos, rev - pos };
+    int32_t best = 0;
+    int32_t best_len = INT32_MAX;
+
+    for (int i = 0; i < 2; i++) {
+        int32_t ahead = horz_wrap(candidates[i] - from);
+        int32_t deltas[2] = { ahead, ahead - rev };
+
+        for (int k = 0; k < 2; k++) {
+            int32_t len = deltas[k] < 0 ? -deltas[k] : deltas[k];
+            if (len < best_len) {
+                best_len = len;
+                best = deltas[k];
+            }
+        }
     }
-    ESP_LOGI(HTAG, "Move to position %ld from %ld", pos, horz_step_counter);
-    if (horz_axis_state != AXIS_READY) 
-    {
-        ESP_LOGI(HTAG, "Axis not ready, cannot move");
-        return;
+    return from + best;
+}
+
+// first crank position at least min_ahead steps forward of `from` that aims
+// at pos, on the way out or back
+static int32_t horz_ahead_target(int32_t from, int32_t pos, int32_t min_ahead)
+{
+    int32_t candidates[2] = { pos, horz_rev_steps() - pos };
+    int32_t best = INT32_MAX;
+
+    for (int i = 0; i < 2; i++) {
+        int32_t ahead = horz_wrap(candidates[i] - from - min_ahead) + min_ahead;
+        if (ahead < best) {
+            best = ahead;
+        }
     }
-    if (pos > horz_total_steps || pos < 0) {
-        ESP_LOGI(HTAG, "Requested position %ld out of range (%ld)", pos, horz_total_steps);
+    return from + best;
+}
+
+static void horz_set_ready(void)
+{
+    // fold the position back into one turn while at rest
+    int32_t pos = step_engine_get_position(STEP_AXIS_HORZ);
+    step_engine_set_position(STEP_AXIS_HORZ, horz_wrap(pos));
+    horz_index_last -= pos - horz_wrap(pos);
+    horz_target_steps = horz_wrap(horz_target_steps);
+
+    horz_axis_state = AXIS_READY;
+    warm_start_store(AXES_HORZ_HOMED_BIT, horz_wrap(pos));
+    axes_set_ready_bit(horz_queue, AXES_HORZ_READY_BIT);
+}
+
+// starts a move on the axis at rest, duration_us of 0 moves at full profile speed
+static void horz_start_move(int32_t pos, uint32_t duration_us)
+{
+    int32_t current = step_engine_get_position(STEP_AXIS_HORZ);
+
+    horz_target_steps = pos;
+    if (pos == current) {
+        ESP_LOGI(HTAG, "Already at position %ld", pos);
+        horz_driver_disable();
+        horz_set_ready();
         return;
     }
-    if (pos < horz_step_counter) {
+    ESP_LOGI(HTAG, "Move to position %ld from %ld", pos, current);
+    if (pos < current) {
         horz_counterclockwise();
     } else {
         horz_clockwise();
     }
 
+    warm_start_invalidate(AXES_HORZ_HOMED_BIT);
     horz_driver_enable();
-    horz_target_steps = pos;
     horz_axis_state = AXIS_MOVING;
+    step_engine_move(STEP_AXIS_HORZ,
+                     pos > current ? pos - current : current - pos,
+                     horz_step_sign(), duration_us);
+}
+
+// drops an armed sweep feed, its ball is not coming
+static void horz_sweep_disarm(void)
+{
+    step_engine_trigger(STEP_AXIS_HORZ, 0, NULL, NULL);
+    if (horz_feed_armed) {
+        horz_feed_armed = false;
+        feed_cancel();
+    }
+}
+
+// queues a move for horz_task, a running move is retargeted
+static void horz_move_to_step(int32_t pos, uint32_t duration_us)
+{
+    if (pos >= horz_rev_steps() || pos < 0) {
+        ESP_LOGI(HTAG, "Requested position %ld out of range (%ld)", pos, horz_rev_steps());
+        return;
+    }
+    if (!axes_post_move(horz_queue, AXES_HORZ_READY_BIT, pos, duration_us)) {
+        ESP_LOGE(HTAG, "Command queue full, dropping move to %ld", pos);
+    }
+}
+
+static int32_t horz_rel_to_step(uint32_t rel)
+{
+    return horz_aim_steps[rel];
 }
 
 void horz_move_to_relative(uint32_t rel)
@@ -596,118 +1914,490 @@ void horz_move_to_relative(uint32_t rel)
         return;
     }
 
-    int32_t range = horz_total_steps;
-
-    int32_t target_step = ((int32_t)rel * range) / 10;
+    int32_t target_step = horz_rel_to_step(rel);
 
     ESP_LOGI(HTAG,
         "Horz move: rel=%lu -> step=%ld",
         rel, target_step
     );
 
-    horz_move_to_step(target_step);
+    horz_move_to_step(target_step, 0);
 }
 
-static void horz_moving(void) {
-    horz_step_pulse();
-    horz_count_step();
+static bool horz_homing(void)
+{
+    return horz_axis_state != AXIS_READY &&
+           horz_axis_state != AXIS_MOVING &&
+           horz_axis_state != AXIS_SWEEPING;
+}
 
-    if (horz_step_counter >= horz_total_steps){
-        horz_step_counter = horz_total_steps;
-        horz_axis_state = AXIS_READY;
-        ESP_LOGI(HTAG, "Reached max limit");
-        horz_driver_disable();
+static void horz_handle_move(int32_t pos, uint32_t duration_us)
+{
+    if (horz_homing()) {
+        ESP_LOGI(HTAG, "Homing, move to %ld deferred", pos);
+        horz_target_steps = pos;
+        horz_move_pending = true;
+        return;
     }
 
-    if (horz_step_counter <= 0){
-        horz_step_counter = 0;
-        horz_axis_state = AXIS_READY;
-        ESP_LOGI(HTAG, "Reached min limit");
-        horz_driver_disable();
+    horz_sweep_pending = false;
+    if (horz_axis_state == AXIS_SWEEPING) {
+        // a sweep ends where it is heading anyway, no reversal, so the target
+        // has to be beyond the stopping distance and the steps taken meanwhile
+        int32_t stop = step_engine_stop_steps(STEP_AXIS_HORZ) + HORZ_RETARGET_MARGIN_STEPS;
+        horz_sweep_disarm();
+        horz_axis_state = AXIS_MOVING;
+        pos = horz_ahead_target(step_engine_get_position(STEP_AXIS_HORZ), pos, stop);
+    } else {
+        pos = horz_path_target(step_engine_get_position(STEP_AXIS_HORZ), pos);
     }
 
-    if (horz_step_counter == horz_target_steps) {
-        ESP_LOGI(HTAG, "Target reached %ld", horz_step_counter);
-        horz_driver_disable();
-        horz_axis_state = AXIS_READY;
+    if (horz_axis_state != AXIS_MOVING) {
+        horz_start_move(pos, duration_us);
+        return;
+    }
+
+    // retarget on the fly, the running move keeps its pace
+    horz_target_steps = pos;
+    if (step_engine_retarget(STEP_AXIS_HORZ, pos)) {
+        ESP_LOGI(HTAG, "Retargeted to %ld", pos);
+    } else {
+        ESP_LOGI(HTAG, "Stopping to reverse towards %ld", pos);
     }
 }
 
-void horz_home(void)
+/*
+ * Every forward pass over the index is a free check of the step count. The
+ * release should be seen at the zero set while homing, any difference is
+ * missed steps and gets folded into the position while the move goes on.
+ */
+static void horz_index_seen(int32_t position)
 {
-    horz_stepper_init();
-    horz_switch_init();
+    int32_t rev = horz_rev_steps();
+    int32_t error = horz_wrap(HORZ_INDEX_OFFSET_STEPS - position);
+
+    // only the first edge of each pass, the switch bounces as it releases
+    if (horz_index_valid && position - horz_index_last < rev / 2 &&
+        horz_index_last - position < rev / 2) {
+        return;
+    }
+    if (error > rev / 2) {
+        error -= rev;
+    }
+    horz_index_last = position + error;
+    horz_index_valid = true;
+    if (error <= HORZ_INDEX_DEADBAND_STEPS && error >= -HORZ_INDEX_DEADBAND_STEPS) {
+        return;
+    }
+    if (error > HORZ_DRIFT_MAX_STEPS || error < -HORZ_DRIFT_MAX_STEPS) {
+        ESP_LOGW(HTAG, "Index seen %ld steps off, ignored", error);
+        return;
+    }
+
+    step_engine_correct(STEP_AXIS_HORZ, error);
+    horz_drift_corrections++;
+    ESP_LOGI(HTAG, "Index drift %ld steps corrected (%lu so far)",
+             error, horz_drift_corrections);
+}
+
+/*
+ * Sweep, the crank turns forward without stopping so the aim swings from side
+ * to side. The index pass keeps correcting drift as on any other move. A move
+ * command ends the sweep, see horz_handle_move().
+ */
+static void horz_sweep_begin(void)
+{
+    ESP_LOGI(HTAG, "Sweep at %lu sps", horz_sweep_sps);
+    horz_sweep_pending = false;
+    warm_start_invalidate(AXES_HORZ_HOMED_BIT);
+    horz_clockwise();
     horz_driver_enable();
-    ESP_LOGI(HTAG, "Horizontal startup");
+    horz_axis_state = AXIS_SWEEPING;
+    step_engine_run(STEP_AXIS_HORZ, horz_step_sign(), horz_sweep_sps);
+}
+
+static void horz_sweep(uint32_t sps)
+{
+    if (horz_homing()) {
+        ESP_LOGW(HTAG, "Homing, sweep ignored");
+        return;
+    }
+    if (horz_axis_state == AXIS_SWEEPING) {
+        return;
+    }
+
+    horz_sweep_sps = sps;
+    if (horz_axis_state == AXIS_MOVING) {
+        // picked up from rest once the running move is done
+        horz_sweep_pending = true;
+        return;
+    }
+    horz_sweep_begin();
+}
+
+// sweep trigger reached, runs in the step engine ISR
+static bool IRAM_ATTR horz_sweep_fire(step_axis_t axis, void *ctx)
+{
+    horz_feed_armed = false;
+    return request_feed_from_isr();
+}
+
+void horz_sweep_start(uint32_t speed)
+{
+    axis_cmd_t sweep = {
+        .type = AXIS_CMD_SWEEP,
+    };
+
+    if (speed == 0 || speed > SWEEP_MAX_SPEED) {
+        ESP_LOGE(HTAG, "horz_sweep_start: invalid speed %lu", speed);
+        return;
+    }
+    sweep.target = (int32_t)(horz_max_sps * speed / SWEEP_MAX_SPEED);
+    if (!axes_post_cmd(horz_queue, AXES_HORZ_READY_BIT, &sweep)) {
+        ESP_LOGE(HTAG, "Command queue full, dropping sweep");
+    }
+}
+
+void horz_sweep_stop(void)
+{
+    horz_sweep_disarm();
+    horz_move_to_step(horz_rel_to_step(5), 0);
+}
+
+/*
+ * Arms the feed so the ball leaves as the sweeping crank passes aim rel. The
+ * feed is requested the measured feed latency ahead of the aim, at the step
+ * count the crank has then reached.
+ */
+bool horz_sweep_feed(uint32_t rel)
+{
+    if (rel > 10 || horz_axis_state != AXIS_SWEEPING) {
+        return false;
+    }
+
+    int32_t lead = (int32_t)((uint64_t)get_feed_latency_us() * horz_sweep_sps / 1000000);
+    int32_t pos = step_engine_get_position(STEP_AXIS_HORZ);
+    int32_t aim = horz_ahead_target(pos, horz_rel_to_step(rel),
+                                    lead + SWEEP_FEED_MARGIN_STEPS);
+
+    if (!feed_arm()) {
+        return false;
+    }
+    horz_feed_armed = true;
+    step_engine_trigger(STEP_AXIS_HORZ, aim - lead, horz_sweep_fire, NULL);
+    ESP_LOGI(HTAG, "Sweep feed at %ld for aim %ld (%ld steps lead)",
+             aim - lead, aim, lead);
+    return true;
+}
+
+uint32_t get_horz_drift_corrections(void)
+{
+    return horz_drift_corrections;
+}
+
+// called once the step engine reports the move as finished
+static void horz_move_done(void)
+{
+    if (step_engine_busy(STEP_AXIS_HORZ)) {
+        return;
+    }
+
+    int32_t pos = step_engine_get_position(STEP_AXIS_HORZ);
+    if (pos != horz_target_steps) {
+        // stopped short because the target moved behind us, head back
+        horz_start_move(horz_target_steps, 0);
+        return;
+    }
+
+    if (horz_sweep_pending) {
+        horz_sweep_begin();
+        return;
+    }
+
+    ESP_LOGI(HTAG, "Target reached %ld", pos);
+    horz_driver_disable();
+    horz_set_ready();
+}
+
+// plain relative move while homing, returns false if there is nothing to do
+static bool horz_home_move(int32_t delta)
+{
+    if (delta == 0) {
+        return false;
+    }
+    if (delta < 0) {
+        horz_counterclockwise();
+    } else {
+        horz_clockwise();
+    }
+    step_engine_move(STEP_AXIS_HORZ, delta < 0 ? -delta : delta, horz_step_sign(), 0);
+    return true;
+}
+
+static void horz_home_seek(bool level, uint32_t sps, int32_t max_steps)
+{
+    horz_clockwise();
+    step_engine_seek(STEP_AXIS_HORZ, horz_step_sign(), HORZ_SWITCH_GPIO, level,
+                     sps, max_steps);
+}
+
+// shortest way to just in front of the index, where the slow pass starts
+static int32_t horz_approach_delta(void)
+{
+    int32_t rev = horz_rev_steps();
+    int32_t pos = step_engine_get_position(STEP_AXIS_HORZ);
+    int32_t delta = horz_wrap(horz_press_steps - HOME_BACKOFF_STEPS - pos);
+
+    return delta > rev / 2 ? delta - rev : delta;
+}
+
+static void horz_home_step(void);
+
+static void horz_home_full(void)
+{
     ESP_LOGI(HTAG, "Finding home");
     horz_axis_state = AXIS_CAL_SEEK_1;
+    horz_seek_limit = 0;
+    horz_home_seek(true, HORZ_HOME_FAST_SPS, 0);
+}
 
-    while (1) {
-        bool sw = horz_switch_pressed();
+/*
+ * Homing runs inside horz_task, each step engine completion advances it.
+ * After a warm start the axis only heads to just in front of the index and
+ * does the slow pass, bounded so that a wrong position falls back to a full
+ * homing run instead of creeping a whole turn.
+ */
+static void horz_home_start(void)
+{
+    int32_t pos;
+
+    horz_switch_init();
+    horz_driver_enable();
+    warm_start_invalidate(AXES_HORZ_HOMED_BIT);
 
-        switch (horz_axis_state) {
+    horz_press_steps = warm_start_press();
+    if (!warm_start_position(AXES_HORZ_HOMED_BIT, &pos)) {
+        horz_home_full();
+        return;
+    }
 
-        case AXIS_CAL_SEEK_1:
-            horz_step_pulse();
-            if (sw) {
-                ESP_LOGI(HTAG, "First press");
-                horz_axis_state = AXIS_CAL_WAIT_RELEASE_1;
-            }
+    ESP_LOGI(HTAG, "Warm start at %ld, verifying index", pos);
+    step_engine_set_position(STEP_AXIS_HORZ, pos);
+    horz_index_valid = false;
+    horz_axis_state = AXIS_CAL_VERIFY;
+    horz_seek_limit = HOME_VERIFY_STEPS;
+    if (!horz_home_move(horz_approach_delta())) {
+        horz_home_step();
+    }
+}
+
+static void horz_home_step(void)
+{
+    int32_t steps;
+    int32_t edge;
+
+    switch (horz_axis_state) {
+
+    case AXIS_CAL_SEEK_1:
+        steps = home_backoff_steps(STEP_AXIS_HORZ, horz_step_sign());
+        ESP_LOGI(HTAG, "First press, backing off %ld steps", steps);
+        horz_axis_state = AXIS_CAL_BACKOFF;
+        horz_home_move(-steps * horz_step_sign());
+        break;
+
+    case AXIS_CAL_VERIFY:
+    case AXIS_CAL_BACKOFF:
+        horz_axis_state = AXIS_CAL_SEEK_2;
+        horz_home_seek(true, HORZ_HOME_SLOW_SPS, horz_seek_limit);
+        break;
+
+    // we have to wait for the release to not only home position
+    // but also know relative direction
+    case AXIS_CAL_SEEK_2:
+        if (!step_engine_seek_latch(STEP_AXIS_HORZ, &edge)) {
+            ESP_LOGW(HTAG, "Index not where expected");
+            horz_home_full();
             break;
+        }
+        ESP_LOGI(HTAG, "Second press");
+        horz_press_steps = edge;
+        horz_axis_state = AXIS_CAL_WAIT_RELEASE_2;
+        horz_home_seek(false, HORZ_HOME_SLOW_SPS, 0);
+        break;
+
+    case AXIS_CAL_WAIT_RELEASE_2:
+        step_engine_seek_latch(STEP_AXIS_HORZ, &edge);
+        if (horz_seek_limit > 0) {
+            ESP_LOGI(HTAG, "Index verified, off by %ld steps",
+                     edge - HORZ_INDEX_OFFSET_STEPS);
+        }
+        ESP_LOGI(HTAG, "Second release → zero");
+        // press position relative to the release, kept for the next warm start
+        horz_press_steps = HORZ_INDEX_OFFSET_STEPS + horz_press_steps - edge;
+        warm_start_store_press(horz_press_steps);
+        step_engine_set_position(STEP_AXIS_HORZ,
+                                 HORZ_INDEX_OFFSET_STEPS + home_past_edge(STEP_AXIS_HORZ));
+        horz_index_valid = false;
+        axes_set_homed_bit(AXES_HORZ_HOMED_BIT);
+        if (!horz_move_pending) {
+            ESP_LOGI(HTAG, "Moving to center");
+            horz_target_steps = horz_rel_to_step(5);
+        }
+        horz_move_pending = false;
+        horz_start_move(horz_path_target(step_engine_get_position(STEP_AXIS_HORZ),
+                                         horz_target_steps), 0);
+        break;
 
-        // we have to wait for the release to not only home position
-        // but also know relative direction
-        case AXIS_CAL_WAIT_RELEASE_1:
-            horz_step_pulse();
-            if (!sw) {
-                ESP_LOGI(HTAG, "First release → zero");
-                horz_step_counter = 0;
-                horz_axis_state = AXIS_READY;
-                ESP_LOGI(HTAG, "Moving to center");
-                horz_move_to_step(horz_total_steps/2);
+    default:
+        ESP_LOGE(HTAG, "Unexpected state %d", horz_axis_state);
+    }
+}
+
+// waits out a self tune move, move requests are kept for after
+static void horz_tune_wait(void)
+{
+    axis_cmd_t cmd;
+
+    while (1) {
+        if (xQueueReceive(horz_queue, &cmd, pdMS_TO_TICKS(AXIS_IDLE_CHECK_MS)) != pdTRUE) {
+            if (!step_engine_busy(STEP_AXIS_HORZ)) {
+                return;
             }
-            break;
-        
-        case AXIS_MOVING:
-            horz_moving();
-            break;
-        
-        case AXIS_READY:
-            ESP_LOGI(HTAG, "Horizontal startup done");
+            continue;
+        }
+        if (cmd.type == AXIS_CMD_DONE) {
             return;
+        }
+        if (cmd.type == AXIS_CMD_MOVE) {
+            horz_target_steps = cmd.target;
+            horz_move_pending = true;
+        }
+    }
+}
 
-        default:
-            ESP_LOGE(HTAG, "Unexpected state %d", horz_axis_state);
+// slow pass over the index, true if it is still where homing found it
+static bool horz_tune_check(void)
+{
+    int32_t rev = horz_rev_steps();
+    int32_t edge;
+
+    if (horz_home_move(horz_approach_delta())) {
+        horz_tune_wait();
+    }
+    horz_home_seek(true, HORZ_HOME_SLOW_SPS, HOME_VERIFY_STEPS);
+    horz_tune_wait();
+    if (!step_engine_seek_latch(STEP_AXIS_HORZ, &edge)) {
+        return false;
+    }
+
+    int32_t error = horz_wrap(edge - horz_press_steps);
+    if (error > rev / 2) {
+        error -= rev;
+    }
+    // count from the switch again, so the next candidate starts out clean
+    step_engine_correct(STEP_AXIS_HORZ, -error);
+    return error <= TUNE_TOLERANCE_STEPS && error >= -TUNE_TOLERANCE_STEPS;
+}
+
+/*
+ * Self tune, blocks horz_task until done. Full turns there and back at rising
+ * cruise speeds, each checked against the index, until steps get lost. The
+ * fastest clean speed less a margin is kept in NVS, then the axis homes again.
+ */
+static void horz_tune(void)
+{
+    uint32_t best = 0;
+    int32_t rev = horz_rev_steps();
+
+    ESP_LOGI(HTAG, "Self tune");
+    horz_axis_state = AXIS_TUNING;
+    warm_start_invalidate(AXES_HORZ_HOMED_BIT);
+    horz_driver_enable();
+
+    for (uint32_t sps = horz_profile.max_sps / 2; sps <= HORZ_TUNE_MAX_SPS;
+         sps = sps * TUNE_STEP_PCT / 100) {
+        step_profile_t profile = profile_at_speed(&horz_profile, sps);
+        if (step_engine_set_profile(STEP_AXIS_HORZ, &profile) < sps) {
+            ESP_LOGW(HTAG, "Self tune stops at %lu sps, ramp too long", sps);
+            break;
+        }
+
+        for (int i = 0; i < TUNE_PASSES; i++) {
+            horz_home_move(rev);
+            horz_tune_wait();
+            horz_home_move(-rev);
+            horz_tune_wait();
         }
+        bool clean = horz_tune_check();
+        ESP_LOGI(HTAG, "Self tune %lu sps: %s", sps, clean ? "clean" : "lost steps");
+        if (!clean) {
+            break;
+        }
+        best = sps;
+    }
+
+    uint32_t sps = tune_result("horz_sps", &horz_profile, best);
+    if (sps > 0) {
+        horz_max_sps = sps;
     }
+    step_profile_t profile = profile_at_speed(&horz_profile, horz_max_sps);
+    step_engine_set_profile(STEP_AXIS_HORZ, &profile);
+    ESP_LOGI(HTAG, "Cruise speed %lu sps", horz_max_sps);
+
+    axes_tune_done(AXES_HORZ_TUNING_BIT, AXES_HORZ_HOMED_BIT);
+    horz_home_full();
 }
 
 void horz_task(void *arg)
 {
-    ESP_LOGI(HTAG, "Waiting for horizontal request");
+    axis_cmd_t cmd;
+
+    ESP_LOGI(HTAG, "Horizontal startup");
+    horz_home_start();
 
     while (1) {
-        switch (horz_axis_state) {
-        case AXIS_MOVING:
-            horz_moving();
+        if (xQueueReceive(horz_queue, &cmd, pdMS_TO_TICKS(AXIS_IDLE_CHECK_MS)) != pdTRUE) {
+            if ((horz_axis_state != AXIS_MOVING && !horz_homing()) ||
+                step_engine_busy(STEP_AXIS_HORZ)) {
+                continue;
+            }
+            ESP_LOGW(HTAG, "Missed completion event");
+            cmd.type = AXIS_CMD_DONE;
+        }
+
+        switch (cmd.type) {
+        case AXIS_CMD_MOVE:
+            horz_handle_move(cmd.target, cmd.duration_us);
+            break;
+
+        case AXIS_CMD_DONE:
+            if (horz_homing()) {
+                horz_home_step();
+            } else {
+                horz_move_done();
+            }
+            break;
+
+        case AXIS_CMD_INDEX:
+            if (!horz_homing()) {
+                horz_index_seen(cmd.target);
+            }
             break;
 
-        case AXIS_READY:
-            vTaskDelay(pdMS_TO_TICKS(100));
+        case AXIS_CMD_TUNE:
+            horz_tune();
             break;
-        
+
+        case AXIS_CMD_SWEEP:
+            horz_sweep((uint32_t)cmd.target);
+            break;
+
         default:
-            vTaskDelay(pdMS_TO_TICKS(100));
-            ESP_LOGI(HTAG, "Unexpected state %d", horz_axis_state);
+            ESP_LOGI(HTAG, "Unexpected command %d", cmd.type);
         }
     }
 }
 
-static bool elev_switch_pressed(void)
-{
-    return debounce_switch(ELEV_SWITCH_GPIO);
-}
-
 static void elev_switch_init(void)
 {
     limit_switch_init(ELEV_SWITCH_GPIO);
@@ -745,13 +2435,9 @@ static void elev_counterclockwise(void)
     gpio_set_level(ELEV_STEP_DIR_GPIO, elev_dir);
 }
 
-static void elev_count_step(void)
+static int8_t elev_step_sign(void)
 {
-    if (elev_dir == 0) {
-        elev_step_counter++;
-    } else {
-        elev_step_counter--;
-    }
+    return elev_dir == 0 ? 1 : -1;
 }
 
 static void elev_stepper_init(void)
@@ -761,75 +2447,70 @@ static void elev_stepper_init(void)
         ELEV_STEP_DIR_GPIO,
         ELEV_STEP_EN_GPIO
     );
+    axes_sync_init();
+    if (elev_queue == NULL) {
+        elev_queue = xQueueCreate(AXIS_QUEUE_LEN, sizeof(axis_cmd_t));
+    }
+    elev_max_sps = tuned_max_sps("elev_sps", &elev_profile, ELEV_TUNE_MAX_SPS);
+    step_profile_t profile = profile_at_speed(&elev_profile, elev_max_sps);
+    step_engine_axis_init(STEP_AXIS_ELEV, ELEV_STEP_STEP_GPIO, &profile,
+                          axis_step_done, elev_queue);
 
     elev_driver_disable();
     elev_counterclockwise();
 }
 
-static void elev_step_pulse(void)
+static void elev_set_ready(void)
 {
-    gpio_set_level(ELEV_STEP_STEP_GPIO, 1);
-    esp_rom_delay_us(ELEV_STEP_DELAY_US); 
-    gpio_set_level(ELEV_STEP_STEP_GPIO, 0);
-    esp_rom_delay_us(ELEV_STEP_DELAY_US);
+    elev_axis_state = ELEV_READY;
+    warm_start_store(AXES_ELEV_HOMED_BIT, step_engine_get_position(STEP_AXIS_ELEV));
+    axes_set_ready_bit(elev_queue, AXES_ELEV_READY_BIT);
 }
 
-void elev_home(void)
+// starts a move on the axis at rest, duration_us of 0 moves at full profile speed
+static void elev_start_move(int32_t pos, uint32_t duration_us)
 {
-    elev_stepper_init();
-    elev_switch_init();
-    elev_driver_enable();
-    ESP_LOGI(ETAG, "Elevation startup");
-    ESP_LOGI(ETAG, "Finding home");
-    elev_axis_state = ELEV_CAL_SEEK_1;
-
-    while (1) {
-        bool sw = elev_switch_pressed();
-
-        switch (elev_axis_state) {
-
-        case ELEV_CAL_SEEK_1:
-            if (sw) {
-                ESP_LOGI(ETAG, "Homing done");
-                elev_step_counter = 0;
-                elev_axis_state = ELEV_READY;
-                elev_driver_disable();
-                return;
-            }
-            elev_step_pulse();
-            break;
-
-        default:
-            ESP_LOGE(ETAG, "Unexpected state %d", elev_axis_state);
-        }
-    }
-}
+    int32_t current = step_engine_get_position(STEP_AXIS_ELEV);
 
-static void elev_move_to_step(int32_t pos)
-{
-    if (pos == elev_step_counter) {
+    elev_target_steps = pos;
+    if (pos == current) {
         ESP_LOGI(ETAG, "Already at position %ld", pos);
+        elev_driver_disable();
+        elev_set_ready();
         return;
     }
-    ESP_LOGI(ETAG, "Move to position %ld from %ld", pos, elev_step_counter);
-    if (elev_axis_state != ELEV_READY) 
-    {
-        ESP_LOGI(ETAG, "Elevation not ready, cannot move");
-        return;
-    }
-    if (pos > elev_total_steps || pos < 0) {
-        ESP_LOGI(ETAG, "Requested position %ld out of range (%ld)", pos, elev_total_steps);
-        return;
-    }
-    if (pos < elev_step_counter) {
+    ESP_LOGI(ETAG, "Move to position %ld from %ld", pos, current);
+    if (pos < current) {
         elev_counterclockwise();
     } else {
         elev_clockwise();
     }
 
+    warm_start_invalidate(AXES_ELEV_HOMED_BIT);
     elev_driver_enable();
-    elev_target_steps = pos;
     elev_axis_state = ELEV_MOVING;
+    step_engine_move(STEP_AXIS_ELEV,
+                     pos > current ? pos - current : current - pos,
+                     elev_step_sign(), duration_us);
+}
+
+// queues a move for elev_task, a running move is retargeted
+static void elev_move_to_step(int32_t pos, uint32_t duration_us)
+{
+    if (pos > elev_total_steps || pos < 0) {
+        ESP_LOGI(ETAG, "Requested position %ld out of range (%ld)", pos, elev_total_steps);
+        return;
+    }
+    if (!axes_post_move(elev_queue, AXES_ELEV_READY_BIT, pos, duration_us)) {
+        ESP_LOGE(ETAG, "Command queue full, dropping move to %ld", pos);
+    }
+}
+
+static int32_t elev_rel_to_step(uint32_t rel)
+{
+    int32_t range = elev_total_steps;
+
+    return ((int32_t)rel * range) / 10;
 }
 
 void elev_move_to_relative(uint32_t rel)
@@ -839,67 +2520,380 @@ void elev_move_to_relative(uint32_t rel)
         return;
     }
 
-    int32_t range = elev_total_steps;
-
-    int32_t target_step = ((int32_t)rel * range) / 10;
+    int32_t target_step = elev_rel_to_step(rel);
 
     ESP_LOGI(ETAG,
         "Elev move: rel=%lu -> step=%ld",
         rel, target_step
     );
 
-    elev_move_to_step(target_step);
+    elev_move_to_step(target_step, 0);
 }
 
+static bool elev_homing(void)
+{
+    return elev_axis_state != ELEV_READY &&
+           elev_axis_state != ELEV_MOVING;
+}
 
-static void elev_move(void) {
-    elev_step_pulse();
-    elev_count_step();
-
-    if (elev_step_counter >= elev_total_steps){
-        elev_step_counter = elev_total_steps;
+// plain relative move while homing, returns false if there is nothing to do
+static bool elev_home_move(int32_t delta)
+{
+    if (delta == 0) {
+        return false;
+    }
+    if (delta < 0) {
         elev_counterclockwise();
-        ESP_LOGI(ETAG, "Reached max limit, setting counterclockwise direction");
+    } else {
+        elev_clockwise();
     }
+    step_engine_move(STEP_AXIS_ELEV, delta < 0 ? -delta : delta, elev_step_sign(), 0);
+    return true;
+}
 
-    if (elev_step_counter <= 0){
-        elev_step_counter = 0;
-        elev_clockwise();
-        ESP_LOGI(ETAG, "Reached min limit, setting clockewise direction");
+static void elev_home_seek(uint32_t sps, int32_t max_steps)
+{
+    elev_counterclockwise();
+    step_engine_seek(STEP_AXIS_ELEV, elev_step_sign(), ELEV_SWITCH_GPIO, true,
+                     sps, max_steps);
+}
+
+static void elev_home_step(void);
+
+static void elev_home_full(void)
+{
+    ESP_LOGI(ETAG, "Finding home");
+    elev_axis_state = ELEV_CAL_SEEK_1;
+    elev_seek_limit = 0;
+    elev_home_seek(ELEV_HOME_FAST_SPS, 0);
+}
+
+// homing runs inside elev_task, a warm start only repeats the slow pass
+static void elev_home_start(void)
+{
+    int32_t pos;
+
+    elev_switch_init();
+    elev_driver_enable();
+    warm_start_invalidate(AXES_ELEV_HOMED_BIT);
+
+    if (!warm_start_position(AXES_ELEV_HOMED_BIT, &pos)) {
+        elev_home_full();
+        return;
+    }
+
+    ESP_LOGI(ETAG, "Warm start at %ld, verifying switch", pos);
+    step_engine_set_position(STEP_AXIS_ELEV, pos);
+    elev_axis_state = ELEV_CAL_VERIFY;
+    elev_seek_limit = HOME_VERIFY_STEPS;
+    if (!elev_home_move(HOME_BACKOFF_STEPS - pos)) {
+        elev_home_step();
+    }
+}
+
+static void elev_home_step(void)
+{
+    int32_t steps;
+    int32_t edge;
+
+    switch (elev_axis_state) {
+
+    case ELEV_CAL_SEEK_1:
+        steps = home_backoff_steps(STEP_AXIS_ELEV, elev_step_sign());
+        ESP_LOGI(ETAG, "Switch found, backing off %ld steps", steps);
+        elev_axis_state = ELEV_CAL_BACKOFF;
+        elev_home_move(-steps * elev_step_sign());
+        break;
+
+    case ELEV_CAL_VERIFY:
+    case ELEV_CAL_BACKOFF:
+        elev_axis_state = ELEV_CAL_SEEK_2;
+        elev_home_seek(ELEV_HOME_SLOW_SPS, elev_seek_limit);
+        break;
+
+    case ELEV_CAL_SEEK_2:
+        if (!step_engine_seek_latch(STEP_AXIS_ELEV, &edge)) {
+            ESP_LOGW(ETAG, "Switch not where expected");
+            elev_home_full();
+            break;
+        }
+        if (elev_seek_limit > 0) {
+            ESP_LOGI(ETAG, "Switch verified, off by %ld steps", edge);
+        }
+        ESP_LOGI(ETAG, "Homing done");
+        step_engine_set_position(STEP_AXIS_ELEV, home_past_edge(STEP_AXIS_ELEV));
+        axes_set_homed_bit(AXES_ELEV_HOMED_BIT);
+        if (!elev_move_pending) {
+            elev_target_steps = 0;
+        }
+        elev_move_pending = false;
+        elev_start_move(elev_target_steps, 0);
+        break;
+
+    default:
+        ESP_LOGE(ETAG, "Unexpected state %d", elev_axis_state);
+    }
+}
+
+static void elev_handle_move(int32_t pos, uint32_t duration_us)
+{
+    if (elev_homing()) {
+        ESP_LOGI(ETAG, "Homing, move to %ld deferred", pos);
+        elev_target_steps = pos;
+        elev_move_pending = true;
+        return;
+    }
+
+    if (elev_axis_state != ELEV_MOVING) {
+        elev_start_move(pos, duration_us);
+        return;
+    }
+
+    // retarget on the fly, the running move keeps its pace
+    elev_target_steps = pos;
+    if (step_engine_retarget(STEP_AXIS_ELEV, pos)) {
+        ESP_LOGI(ETAG, "Retargeted to %ld", pos);
+    } else {
+        ESP_LOGI(ETAG, "Stopping to reverse towards %ld", pos);
+    }
+}
+
+// called once the step engine reports the move as finished
+static void elev_move_done(void)
+{
+    if (step_engine_busy(STEP_AXIS_ELEV)) {
+        return;
+    }
+
+    int32_t pos = step_engine_get_position(STEP_AXIS_ELEV);
+    if (pos != elev_target_steps) {
+        // stopped short because the target moved behind us, head back
+        elev_start_move(elev_target_steps, 0);
+        return;
     }
 
-    if (elev_step_counter == elev_target_steps) {
-        ESP_LOGI(ETAG, "Target reached %ld", elev_step_counter);
-        elev_axis_state = ELEV_READY;
+    ESP_LOGI(ETAG, "Target reached %ld", pos);
+    elev_driver_disable();
+    elev_set_ready();
+}
+
+// waits out a self tune move, move requests are kept for after
+static void elev_tune_wait(void)
+{
+    axis_cmd_t cmd;
+
+    while (1) {
+        if (xQueueReceive(elev_queue, &cmd, pdMS_TO_TICKS(AXIS_IDLE_CHECK_MS)) != pdTRUE) {
+            if (!step_engine_busy(STEP_AXIS_ELEV)) {
+                return;
+            }
+            continue;
+        }
+        if (cmd.type == AXIS_CMD_DONE) {
+            return;
+        }
+        if (cmd.type == AXIS_CMD_MOVE) {
+            elev_target_steps = cmd.target;
+            elev_move_pending = true;
+        }
     }
 }
 
+// slow pass onto the switch, true if it is still where homing found it
+static bool elev_tune_check(void)
+{
+    int32_t edge;
+
+    if (elev_home_move(HOME_BACKOFF_STEPS - step_engine_get_position(STEP_AXIS_ELEV))) {
+        elev_tune_wait();
+    }
+    elev_home_seek(ELEV_HOME_SLOW_SPS, HOME_VERIFY_STEPS);
+    elev_tune_wait();
+    if (!step_engine_seek_latch(STEP_AXIS_ELEV, &edge)) {
+        return false;
+    }
+    step_engine_correct(STEP_AXIS_ELEV, -edge);
+    return edge <= TUNE_TOLERANCE_STEPS && edge >= -TUNE_TOLERANCE_STEPS;
+}
+
+// self tune, full range moves up and down, see horz_tune()
+static void elev_tune(void)
+{
+    uint32_t best = 0;
+
+    ESP_LOGI(ETAG, "Self tune");
+    elev_axis_state = ELEV_TUNING;
+    warm_start_invalidate(AXES_ELEV_HOMED_BIT);
+    elev_driver_enable();
+
+    for (uint32_t sps = elev_profile.max_sps / 2; sps <= ELEV_TUNE_MAX_SPS;
+         sps = sps * TUNE_STEP_PCT / 100) {
+        step_profile_t profile = profile_at_speed(&elev_profile, sps);
+        if (step_engine_set_profile(STEP_AXIS_ELEV, &profile) < sps) {
+            ESP_LOGW(ETAG, "Self tune stops at %lu sps, ramp too long", sps);
+            break;
+        }
+
+        for (int i = 0; i < TUNE_PASSES; i++) {
+            elev_home_move(elev_total_steps - step_engine_get_position(STEP_AXIS_ELEV));
+            elev_tune_wait();
+            elev_home_move(HOME_BACKOFF_STEPS - step_engine_get_position(STEP_AXIS_ELEV));
+            elev_tune_wait();
+        }
+        bool clean = elev_tune_check();
+        ESP_LOGI(ETAG, "Self tune %lu sps: %s", sps, clean ? "clean" : "lost steps");
+        if (!clean) {
+            break;
+        }
+        best = sps;
+    }
+
+    uint32_t sps = tune_result("elev_sps", &elev_profile, best);
+    if (sps > 0) {
+        elev_max_sps = sps;
+    }
+    step_profile_t profile = profile_at_speed(&elev_profile, elev_max_sps);
+    step_engine_set_profile(STEP_AXIS_ELEV, &profile);
+    ESP_LOGI(ETAG, "Cruise speed %lu sps", elev_max_sps);
+
+    axes_tune_done(AXES_ELEV_TUNING_BIT, AXES_ELEV_HOMED_BIT);
+    elev_home_full();
+}
+
 void elev_task(void *arg)
 {
-    ESP_LOGI(ETAG, "Waiting for elevation request");
+    axis_cmd_t cmd;
+
+    ESP_LOGI(ETAG, "Elevation startup");
+    elev_home_start();
 
     while (1) {
-        switch (elev_axis_state) {
-        case ELEV_MOVING:
-            elev_driver_enable();
-            elev_move();
+        if (xQueueReceive(elev_queue, &cmd, pdMS_TO_TICKS(AXIS_IDLE_CHECK_MS)) != pdTRUE) {
+            if ((elev_axis_state != ELEV_MOVING && !elev_homing()) ||
+                step_engine_busy(STEP_AXIS_ELEV)) {
+                continue;
+            }
+            ESP_LOGW(ETAG, "Missed completion event");
+            cmd.type = AXIS_CMD_DONE;
+        }
+
+        switch (cmd.type) {
+        case AXIS_CMD_MOVE:
+            elev_handle_move(cmd.target, cmd.duration_us);
+            break;
+
+        case AXIS_CMD_DONE:
+            if (elev_homing()) {
+                elev_home_step();
+            } else {
+                elev_move_done();
+            }
             break;
 
-        case ELEV_READY:
-            elev_driver_disable();
-            vTaskDelay(pdMS_TO_TICKS(100));
+        case AXIS_CMD_TUNE:
+            elev_tune();
             break;
-        
+
         default:
-            elev_driver_disable();
-            vTaskDelay(pdMS_TO_TICKS(100));
-            ESP_LOGI(ETAG, "Unexpected state %d", elev_axis_state);
+            ESP_LOGI(ETAG, "Unexpected command %d", cmd.type);
         }
     }
 }
 
+static uint32_t steps_between(int32_t from, int32_t to)
+{
+    return from > to ? from - to : to - from;
+}
+
+void axes_move_to_relative(uint32_t horz_rel, uint32_t elev_rel, uint32_t deadline_ms)
+{
+    if (horz_rel > 10 || elev_rel > 10) {
+        ESP_LOGE(TAG, "axes_move_to_relative: invalid value %lu/%lu", horz_rel, elev_rel);
+        return;
+    }
+
+    int32_t horz_target = horz_rel_to_step(horz_rel);
+    int32_t elev_target = elev_rel_to_step(elev_rel);
+    int32_t horz_pos = step_engine_get_position(STEP_AXIS_HORZ);
+    uint32_t horz_us = step_engine_move_duration_us(STEP_AXIS_HORZ,
+        steps_between(horz_pos, horz_path_target(horz_pos, horz_target)));
+    uint32_t elev_us = step_engine_move_duration_us(STEP_AXIS_ELEV,
+        steps_between(step_engine_get_position(STEP_AXIS_ELEV), elev_target));
+
+    // the slower axis sets the pace, the other one is stretched to match
+    uint32_t duration_us = horz_us > elev_us ? horz_us : elev_us;
+    uint32_t deadline_us = deadline_ms * 1000;
+
+    if (deadline_us > duration_us) {
+        duration_us = deadline_us;
+    } else if (deadline_ms > 0 && deadline_us < duration_us) {
+        ESP_LOGW(TAG, "Deadline %lu ms too short, move needs %lu ms",
+                 deadline_ms, duration_us / 1000);
+    }
+
+    ESP_LOGI(TAG, "Coordinated move: horz=%lu elev=%lu in %lu ms",
+             horz_rel, elev_rel, duration_us / 1000);
+
+    horz_move_to_step(horz_target, duration_us);
+    elev_move_to_step(elev_target, duration_us);
+}
+
+bool steppers_self_tune(void)
+{
+    axis_cmd_t tune = {
+        .type = AXIS_CMD_TUNE,
+    };
+
+    // a move or sweep still running would be restarted by the tune and its
+    // completion taken for the first tune pass, so both axes have to be at rest
+    xSemaphoreTake(axes_cmd_lock, portMAX_DELAY);
+    EventBits_t bits = xEventGroupGetBits(axes_events);
+    bool idle = axes_homed() && !(bits & AXES_TUNING_BITS) &&
+                (bits & AXES_READY_BITS) == AXES_READY_BITS &&
+                uxQueueMessagesWaiting(horz_queue) == 0 &&
+                uxQueueMessagesWaiting(elev_queue) == 0;
+    if (idle) {
+        xEventGroupSetBits(axes_events, AXES_TUNING_BITS);
+    }
+    xSemaphoreGive(axes_cmd_lock);
+    if (!idle) {
+        ESP_LOGW(TAG, "Self tune needs both axes homed and at rest");
+        return false;
+    }
+
+    set_frankenshot_state(FRANKENSHOT_STATE_TUNING);
+    if (!axes_post_cmd(horz_queue, AXES_HORZ_READY_BIT, &tune)) {
+        axes_tune_done(AXES_HORZ_TUNING_BIT, 0);
+    }
+    if (!axes_post_cmd(elev_queue, AXES_ELEV_READY_BIT, &tune)) {
+        axes_tune_done(AXES_ELEV_TUNING_BIT, 0);
+    }
+    return true;
+}
+
+bool axes_homed(void)
+{
+    EventBits_t bits = xEventGroupGetBits(axes_events);
+    return (bits & AXES_HOMED_BITS) == AXES_HOMED_BITS;
+}
+
+bool elev_wait_ready(uint32_t timeout_ms)
+{
+    EventBits_t bits = xEventGroupWaitBits(axes_events, AXES_ELEV_READY_BIT,
+                                           pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & AXES_ELEV_READY_BIT) != 0;
+}
+
+bool axes_wait_ready(uint32_t timeout_ms)
+{
+    EventBits_t bits = xEventGroupWaitBits(axes_events, AXES_READY_BITS,
+                                           pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & AXES_READY_BITS) == AXES_READY_BITS;
+}
+
 void steppers_init(void)
 {
+    warm_start_load();
     horz_stepper_init();
     elev_stepper_init();
 }
@@ -962,9 +2956,7 @@ void app_main(void)
 #if MAIN == 3
 void app_main(void)
 {
-   horz_stepper_init();
-   elev_home();
-   vTaskDelay(pdMS_TO_TICKS(10));
+   steppers_init();
    xTaskCreate(elev_task, "Elevation", 4*1024, NULL, 5, NULL);
    vTaskDelay(pdMS_TO_TICKS(1000));   
    elev_move_to_relative(5);
@@ -980,7 +2972,7 @@ void app_main(void)
    vTaskDelay(pdMS_TO_TICKS(10));
    xTaskCreate(feed_task, "Feed", 4*1024, NULL, 5, NULL);
    vTaskDelay(pdMS_TO_TICKS(1000));   
-   feed_requested();
+   request_feed();
    vTaskDelay(pdMS_TO_TICKS(1000));
 }
 #endif
@@ -991,13 +2983,10 @@ void app_main(void)
 {
     // these and only these is api
     elev_motors_init();
-    vTaskDelay(pdMS_TO_TICKS(10));
-    horz_home();
-    vTaskDelay(pdMS_TO_TICKS(10));
-    elev_home();
-    vTaskDelay(pdMS_TO_TICKS(10));
+    steppers_init();
 
     xTaskCreate(feed_task, "Feeder", 4*1024, NULL, 5, NULL);
+    xTaskCreate(wheel_task, "Wheels", 4*1024, NULL, 6, NULL);
     xTaskCreate(elev_task, "Elevation", 4*1024, NULL, 5, NULL);
     xTaskCreate(horz_task, "Horizontal", 4*1024, NULL, 5, NULL);
 
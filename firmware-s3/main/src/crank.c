@@ -0,0 +1,53 @@
+#include "common.h"
+#include "crank.h"
+
+#include <math.h>
+
+#define CRANK_SOLVE_ITERATIONS  32
+
+// slider travel away from the dead centre at crank angle theta, 0..2r
+static float crank_slider_travel(const crank_geometry_t *geo, float theta)
+{
+    float r = geo->crank_radius;
+    float l = geo->rod_length;
+    float s = r * sinf(theta);
+
+    return (r + l) - (r * cosf(theta) + sqrtf(l * l - s * s));
+}
+
+/*
+ * Slider travel grows monotonically over the first half turn, so the crank
+ * angle of a given travel is found by bisection. The table is only built once
+ * at startup, float math is fine here.
+ */
+void crank_build_aim_table(const crank_geometry_t *geo, int32_t half_rev_steps,
+                           int32_t *steps, uint32_t count)
+{
+    float r = geo->crank_radius;
+    float max_aim = geo->pivot_arm > 0.0f ? atanf(r / geo->pivot_arm) : 0.0f;
+
+    for (uint32_t i = 0; i < count; i++) {
+        float frac = count > 1 ? (float)i / (float)(count - 1) : 0.5f;
+        float travel;
+
+        if (geo->pivot_arm > 0.0f) {
+            float aim = max_aim * (2.0f * frac - 1.0f);
+            travel = r + geo->pivot_arm * tanf(aim);
+        } else {
+            travel = 2.0f * r * frac;
+        }
+
+        float lo = 0.0f;
+        float hi = (float)M_PI;
+        for (int k = 0; k < CRANK_SOLVE_ITERATIONS; k++) {
+            float mid = 0.5f * (lo + hi);
+            if (crank_slider_travel(geo, mid) < travel) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+
+        steps[i] = (int32_t)(0.5f * (lo + hi) / (float)M_PI * (float)half_rev_steps + 0.5f);
+    }
+}
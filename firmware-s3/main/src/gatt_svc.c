@@ -4,6 +4,7 @@
 #include "led.h"
 #include "esp_random.h"
 #include "controller.h"
+#include "settings.h"
 
 /* Private function declarations */
 static int heart_rate_chr_access(uint16_t conn_handle, uint16_t attr_handle,
@@ -18,6 +19,14 @@ static int frankenshot_manualfeed_chr_access(uint16_t conn_handle, uint16_t attr
                                              struct ble_gatt_access_ctxt *ctxt, void *arg);
 static int frankenshot_program_chr_access(uint16_t conn_handle, uint16_t attr_handle,
                                           struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_status_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                         struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_command_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                          struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_sweep_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                        struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_idle_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                       struct ble_gatt_access_ctxt *ctxt, void *arg);
 static int frankenshot_config_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
                                          struct ble_gatt_access_ctxt *ctxt, void *arg);
 static int frankenshot_feeding_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
@@ -26,6 +35,14 @@ static int frankenshot_manualfeed_dsc_access(uint16_t conn_handle, uint16_t attr
                                              struct ble_gatt_access_ctxt *ctxt, void *arg);
 static int frankenshot_program_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
                                           struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_status_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                         struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_command_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                          struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_sweep_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                        struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int frankenshot_idle_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                       struct ble_gatt_access_ctxt *ctxt, void *arg);
 
 /* Heart rate service */
 static const ble_uuid16_t heart_rate_svc_uuid = BLE_UUID16_INIT(0x180D);
@@ -69,6 +86,26 @@ static const ble_uuid128_t frankenshot_program_chr_uuid =
     BLE_UUID128_INIT(0x00, 0x00, 0x00, 0x04, 0x46, 0x52, 0x41, 0x4e,
                      0x4b, 0x45, 0x4e, 0x53, 0x48, 0x4f, 0x54, 0x01);
 
+static uint16_t frankenshot_status_chr_val_handle;
+static const ble_uuid128_t frankenshot_status_chr_uuid =
+    BLE_UUID128_INIT(0x00, 0x00, 0x00, 0x05, 0x46, 0x52, 0x41, 0x4e,
+                     0x4b, 0x45, 0x4e, 0x53, 0x48, 0x4f, 0x54, 0x01);
+
+static uint16_t frankenshot_command_chr_val_handle;
+static const ble_uuid128_t frankenshot_command_chr_uuid =
+    BLE_UUID128_INIT(0x00, 0x00, 0x00, 0x06, 0x46, 0x52, 0x41, 0x4e,
+                     0x4b, 0x45, 0x4e, 0x53, 0x48, 0x4f, 0x54, 0x01);
+
+static uint16_t frankenshot_sweep_chr_val_handle;
+static const ble_uuid128_t frankenshot_sweep_chr_uuid =
+    BLE_UUID128_INIT(0x00, 0x00, 0x00, 0x07, 0x46, 0x52, 0x41, 0x4e,
+                     0x4b, 0x45, 0x4e, 0x53, 0x48, 0x4f, 0x54, 0x01);
+
+static uint16_t frankenshot_idle_chr_val_handle;
+static const ble_uuid128_t frankenshot_idle_chr_uuid =
+    BLE_UUID128_INIT(0x00, 0x00, 0x00, 0x08, 0x46, 0x52, 0x41, 0x4e,
+                     0x4b, 0x45, 0x4e, 0x53, 0x48, 0x4f, 0x54, 0x01);
+
 /* Frankenshot configuration data */
 static frankenshot_config_t frankenshot_config = {
     .speed = 0,
@@ -91,6 +128,22 @@ static frankenshot_program_t frankenshot_program = {
 /* Current config index within program */
 static uint8_t current_config_index = 0;
 
+/* Frankenshot machine state, homing until both axes found their switch */
+static volatile frankenshot_state_t frankenshot_state = FRANKENSHOT_STATE_HOMING;
+
+/* Frankenshot sweep mode, off until the app asks for it */
+static frankenshot_sweep_t frankenshot_sweep = {
+    .mode = FRANKENSHOT_SWEEP_OFF,
+    .speed = FRANKENSHOT_SWEEP_MAX_SPEED / 2
+};
+
+/* Frankenshot idle policy, kept in NVS */
+static frankenshot_idle_t frankenshot_idle = {
+    .policy = FRANKENSHOT_IDLE_HOLD,
+    .speed = 3,
+    .timeout_s = 120
+};
+
 /* Frankenshot config indication tracking */
 static uint16_t frankenshot_config_chr_conn_handle = 0;
 static bool frankenshot_config_chr_conn_handle_inited = false;
@@ -101,6 +154,11 @@ static uint16_t frankenshot_feeding_chr_conn_handle = 0;
 static bool frankenshot_feeding_chr_conn_handle_inited = false;
 static bool frankenshot_feeding_ind_status = false;
 
+/* Frankenshot status indication tracking */
+static uint16_t frankenshot_status_chr_conn_handle = 0;
+static bool frankenshot_status_chr_conn_handle_inited = false;
+static bool frankenshot_status_ind_status = false;
+
 /* GATT services table */
 static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
     /* Heart rate service */
@@ -175,6 +233,46 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
                                               .att_flags = BLE_ATT_F_READ,
                                               .access_cb = frankenshot_program_dsc_access},
                                              {0}}},
+                                        /* Status characteristic */
+                                        {.uuid = &frankenshot_status_chr_uuid.u,
+                                         .access_cb = frankenshot_status_chr_access,
+                                         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_INDICATE,
+                                         .val_handle = &frankenshot_status_chr_val_handle,
+                                         .descriptors = (struct ble_gatt_dsc_def[]){
+                                             {.uuid = BLE_UUID16_DECLARE(0x2901),
+                                              .att_flags = BLE_ATT_F_READ,
+                                              .access_cb = frankenshot_status_dsc_access},
+                                             {0}}},
+                                        /* Command characteristic */
+                                        {.uuid = &frankenshot_command_chr_uuid.u,
+                                         .access_cb = frankenshot_command_chr_access,
+                                         .flags = BLE_GATT_CHR_F_WRITE,
+                                         .val_handle = &frankenshot_command_chr_val_handle,
+                                         .descriptors = (struct ble_gatt_dsc_def[]){
+                                             {.uuid = BLE_UUID16_DECLARE(0x2901),
+                                              .att_flags = BLE_ATT_F_READ,
+                                              .access_cb = frankenshot_command_dsc_access},
+                                             {0}}},
+                                        /* Sweep characteristic */
+                                        {.uuid = &frankenshot_sweep_chr_uuid.u,
+                                         .access_cb = frankenshot_sweep_chr_access,
+                                         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+                                         .val_handle = &frankenshot_sweep_chr_val_handle,
+                                         .descriptors = (struct ble_gatt_dsc_def[]){
+                                             {.uuid = BLE_UUID16_DECLARE(0x2901),
+                                              .att_flags = BLE_ATT_F_READ,
+                                              .access_cb = frankenshot_sweep_dsc_access},
+                                             {0}}},
+                                        /* Idle characteristic */
+                                        {.uuid = &frankenshot_idle_chr_uuid.u,
+                                         .access_cb = frankenshot_idle_chr_access,
+                                         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
+                                         .val_handle = &frankenshot_idle_chr_val_handle,
+                                         .descriptors = (struct ble_gatt_dsc_def[]){
+                                             {.uuid = BLE_UUID16_DECLARE(0x2901),
+                                              .att_flags = BLE_ATT_F_READ,
+                                              .access_cb = frankenshot_idle_dsc_access},
+                                             {0}}},
                                         {0}},
     },
 
@@ -369,8 +467,7 @@ static int frankenshot_manualfeed_chr_access(uint16_t conn_handle, uint16_t attr
 
         if (attr_handle == frankenshot_manualfeed_chr_val_handle) {
             ESP_LOGI(TAG, "manual feed command received");
-            frankenshot_feeding = false;  /* Pause program */
-            send_frankenshot_feeding_indication();
+            pause_frankenshot_feeding();
             request_feed();
             return 0;
         }
@@ -459,6 +556,246 @@ error:
     return BLE_ATT_ERR_UNLIKELY;
 }
 
+static int frankenshot_status_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                         struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    int rc = 0;
+
+    switch (ctxt->op) {
+
+    case BLE_GATT_ACCESS_OP_READ_CHR:
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            ESP_LOGI(TAG, "frankenshot status read; conn_handle=%d attr_handle=%d",
+                     conn_handle, attr_handle);
+        }
+
+        if (attr_handle == frankenshot_status_chr_val_handle) {
+            uint32_t corrections = get_horz_drift_corrections();
+            uint32_t jams = get_feed_jams();
+            uint32_t cleared = get_feed_jams_cleared();
+            frankenshot_status_t status = {
+                .state = (uint8_t)frankenshot_state,
+                .drift_corrections = corrections > UINT16_MAX ? UINT16_MAX : corrections,
+                .battery_mv = (uint16_t)get_supply_mv(),
+                .battery_pct = get_battery_pct(),
+                .flags = (is_battery_low() ? FRANKENSHOT_STATUS_BATTERY_LOW : 0) |
+                         (is_feed_prestage() ? FRANKENSHOT_STATUS_PRESTAGE : 0) |
+                         (is_feed_jammed() ? FRANKENSHOT_STATUS_FEED_JAMMED : 0),
+                .feed_jams = jams > UINT16_MAX ? UINT16_MAX : jams,
+                .feed_jams_cleared = cleared > UINT16_MAX ? UINT16_MAX : cleared,
+            };
+            rc = os_mbuf_append(ctxt->om, &status, sizeof(status));
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        goto error;
+
+    default:
+        goto error;
+    }
+
+error:
+    ESP_LOGE(TAG,
+             "unexpected access operation to frankenshot status characteristic, opcode: %d",
+             ctxt->op);
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+static int frankenshot_command_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    switch (ctxt->op) {
+
+    case BLE_GATT_ACCESS_OP_WRITE_CHR:
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            ESP_LOGI(TAG, "frankenshot command write; conn_handle=%d attr_handle=%d",
+                     conn_handle, attr_handle);
+        }
+
+        if (attr_handle == frankenshot_command_chr_val_handle) {
+            if (ctxt->om->om_len < 1) {
+                ESP_LOGE(TAG, "command data too short: %d", ctxt->om->om_len);
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            }
+
+            switch (ctxt->om->om_data[0]) {
+            case FRANKENSHOT_CMD_SELF_TUNE:
+                if (frankenshot_feeding || !steppers_self_tune()) {
+                    ESP_LOGE(TAG, "self tune refused, pause and wait for homing first");
+                    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+                }
+                return 0;
+
+            case FRANKENSHOT_CMD_CAL_SET: {
+                const uint8_t *d = ctxt->om->om_data;
+                if (ctxt->om->om_len != 7) {
+                    ESP_LOGE(TAG, "invalid calibration size: %d (expected 7)",
+                             ctxt->om->om_len);
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                if (frankenshot_feeding ||
+                    !elev_motors_calibrate(d[1], d[2], d[3] | (d[4] << 8), d[5] | (d[6] << 8))) {
+                    ESP_LOGE(TAG, "calibration refused, pause first and stay in range");
+                    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+                }
+                return 0;
+            }
+
+            case FRANKENSHOT_CMD_CAL_SAVE:
+            case FRANKENSHOT_CMD_CAL_RESET:
+                if (frankenshot_feeding) {
+                    ESP_LOGE(TAG, "calibration refused while feeding");
+                    return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+                }
+                if (!(ctxt->om->om_data[0] == FRANKENSHOT_CMD_CAL_SAVE ?
+                      elev_motors_cal_save() : elev_motors_cal_reset())) {
+                    return BLE_ATT_ERR_UNLIKELY;
+                }
+                return 0;
+
+            case FRANKENSHOT_CMD_PRESTAGE: {
+                uint8_t enable;
+                if (ctxt->om->om_len != 2 || ctxt->om->om_data[1] > 1) {
+                    ESP_LOGE(TAG, "invalid pre-stage command");
+                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                }
+                enable = ctxt->om->om_data[1];
+                feed_set_prestage(enable);
+                settings_save("prestage", &enable, sizeof(enable));
+                send_frankenshot_status_indication();
+                return 0;
+            }
+
+            default:
+                ESP_LOGE(TAG, "unknown command: %d", ctxt->om->om_data[0]);
+                return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+            }
+        }
+        goto error;
+
+    default:
+        goto error;
+    }
+
+error:
+    ESP_LOGE(TAG,
+             "unexpected access operation to frankenshot command characteristic, opcode: %d",
+             ctxt->op);
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+static int frankenshot_sweep_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                        struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    int rc = 0;
+
+    switch (ctxt->op) {
+
+    case BLE_GATT_ACCESS_OP_READ_CHR:
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            ESP_LOGI(TAG, "frankenshot sweep read; conn_handle=%d attr_handle=%d",
+                     conn_handle, attr_handle);
+        }
+
+        if (attr_handle == frankenshot_sweep_chr_val_handle) {
+            rc = os_mbuf_append(ctxt->om, &frankenshot_sweep, sizeof(frankenshot_sweep));
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        goto error;
+
+    case BLE_GATT_ACCESS_OP_WRITE_CHR:
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            ESP_LOGI(TAG, "frankenshot sweep write; conn_handle=%d attr_handle=%d",
+                     conn_handle, attr_handle);
+        }
+
+        if (attr_handle == frankenshot_sweep_chr_val_handle) {
+            if (ctxt->om->om_len != sizeof(frankenshot_sweep_t)) {
+                ESP_LOGE(TAG, "invalid sweep size: %d (expected %d)",
+                         ctxt->om->om_len, sizeof(frankenshot_sweep_t));
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            }
+
+            frankenshot_sweep_t sweep;
+            memcpy(&sweep, ctxt->om->om_data, sizeof(sweep));
+            if (sweep.mode > FRANKENSHOT_SWEEP_HORIZONTAL || sweep.speed == 0 ||
+                sweep.speed > FRANKENSHOT_SWEEP_MAX_SPEED) {
+                ESP_LOGE(TAG, "invalid sweep: mode=%d speed=%d", sweep.mode, sweep.speed);
+                return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+            }
+
+            frankenshot_sweep = sweep;
+            ESP_LOGI(TAG, "frankenshot sweep updated: mode=%d speed=%d",
+                     frankenshot_sweep.mode, frankenshot_sweep.speed);
+            return rc;
+        }
+        goto error;
+
+    default:
+        goto error;
+    }
+
+error:
+    ESP_LOGE(TAG,
+             "unexpected access operation to frankenshot sweep characteristic, opcode: %d",
+             ctxt->op);
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+static int frankenshot_idle_chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                                       struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    int rc = 0;
+
+    switch (ctxt->op) {
+
+    case BLE_GATT_ACCESS_OP_READ_CHR:
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            ESP_LOGI(TAG, "frankenshot idle read; conn_handle=%d attr_handle=%d",
+                     conn_handle, attr_handle);
+        }
+
+        if (attr_handle == frankenshot_idle_chr_val_handle) {
+            rc = os_mbuf_append(ctxt->om, &frankenshot_idle, sizeof(frankenshot_idle));
+            return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        }
+        goto error;
+
+    case BLE_GATT_ACCESS_OP_WRITE_CHR:
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            ESP_LOGI(TAG, "frankenshot idle write; conn_handle=%d attr_handle=%d",
+                     conn_handle, attr_handle);
+        }
+
+        if (attr_handle == frankenshot_idle_chr_val_handle) {
+            if (ctxt->om->om_len != sizeof(frankenshot_idle_t)) {
+                ESP_LOGE(TAG, "invalid idle size: %d (expected %d)",
+                         ctxt->om->om_len, sizeof(frankenshot_idle_t));
+                return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            }
+
+            frankenshot_idle_t idle;
+            memcpy(&idle, ctxt->om->om_data, sizeof(idle));
+            if (idle.policy > FRANKENSHOT_IDLE_REDUCED || idle.speed == 0 || idle.speed > 10) {
+                ESP_LOGE(TAG, "invalid idle: policy=%d speed=%d", idle.policy, idle.speed);
+                return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+            }
+
+            frankenshot_idle = idle;
+            settings_save("idle", &frankenshot_idle, sizeof(frankenshot_idle));
+            ESP_LOGI(TAG, "frankenshot idle updated: policy=%d speed=%d timeout=%d s",
+                     frankenshot_idle.policy, frankenshot_idle.speed,
+                     frankenshot_idle.timeout_s);
+            return rc;
+        }
+        goto error;
+
+    default:
+        goto error;
+    }
+
+error:
+    ESP_LOGE(TAG,
+             "unexpected access operation to frankenshot idle characteristic, opcode: %d",
+             ctxt->op);
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
 static int frankenshot_config_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
                                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
     static const char *desc = "Configuration";
@@ -499,6 +836,46 @@ static int frankenshot_program_dsc_access(uint16_t conn_handle, uint16_t attr_ha
     return BLE_ATT_ERR_UNLIKELY;
 }
 
+static int frankenshot_status_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                         struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    static const char *desc = "Status";
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_DSC) {
+        int rc = os_mbuf_append(ctxt->om, desc, strlen(desc));
+        return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+static int frankenshot_command_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    static const char *desc = "Command";
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_DSC) {
+        int rc = os_mbuf_append(ctxt->om, desc, strlen(desc));
+        return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+static int frankenshot_sweep_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                        struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    static const char *desc = "Sweep";
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_DSC) {
+        int rc = os_mbuf_append(ctxt->om, desc, strlen(desc));
+        return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+static int frankenshot_idle_dsc_access(uint16_t conn_handle, uint16_t attr_handle,
+                                       struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    static const char *desc = "Idle";
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_DSC) {
+        int rc = os_mbuf_append(ctxt->om, desc, strlen(desc));
+        return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
 void send_heart_rate_indication(void) {
     if (heart_rate_ind_status && heart_rate_chr_conn_handle_inited) {
         ble_gatts_indicate(heart_rate_chr_conn_handle,
@@ -586,6 +963,14 @@ void gatt_svr_subscribe_cb(struct ble_gap_event *event) {
         frankenshot_feeding_chr_conn_handle_inited = true;
         frankenshot_feeding_ind_status = event->subscribe.cur_indicate;
     }
+
+    /* Check for frankenshot status subscription */
+    if (event->subscribe.attr_handle == frankenshot_status_chr_val_handle) {
+        /* Update frankenshot status subscription status */
+        frankenshot_status_chr_conn_handle = event->subscribe.conn_handle;
+        frankenshot_status_chr_conn_handle_inited = true;
+        frankenshot_status_ind_status = event->subscribe.cur_indicate;
+    }
 }
 
 const frankenshot_config_t *get_frankenshot_config(void) {
@@ -596,6 +981,21 @@ bool get_frankenshot_feeding(void) {
     return frankenshot_feeding;
 }
 
+/* Pause the program, e.g. for a manual feed or a jam */
+void pause_frankenshot_feeding(void) {
+    frankenshot_feeding = false;
+    send_frankenshot_feeding_indication();
+}
+
+/* Config speed in hundredths, 0 if the value is invalid */
+uint32_t frankenshot_speed_centi(uint8_t speed) {
+    if (speed & FRANKENSHOT_SPEED_FINE) {
+        uint32_t tenths = speed & ~FRANKENSHOT_SPEED_FINE;
+        return tenths >= 10 && tenths <= 100 ? tenths * 10 : 0;
+    }
+    return speed >= 1 && speed <= 10 ? speed * 100 : 0;
+}
+
 const frankenshot_program_t *get_frankenshot_program(void) {
     return &frankenshot_program;
 }
@@ -612,6 +1012,24 @@ uint8_t get_current_config_index(void) {
     return current_config_index;
 }
 
+void set_frankenshot_state(frankenshot_state_t state) {
+    frankenshot_state = state;
+    ESP_LOGI(TAG, "frankenshot state updated: %d", state);
+    send_frankenshot_status_indication();
+}
+
+frankenshot_state_t get_frankenshot_state(void) {
+    return frankenshot_state;
+}
+
+const frankenshot_sweep_t *get_frankenshot_sweep(void) {
+    return &frankenshot_sweep;
+}
+
+const frankenshot_idle_t *get_frankenshot_idle(void) {
+    return &frankenshot_idle;
+}
+
 void send_frankenshot_config_indication(void) {
     if (frankenshot_config_ind_status && frankenshot_config_chr_conn_handle_inited) {
         ble_gatts_indicate(frankenshot_config_chr_conn_handle,
@@ -628,6 +1046,14 @@ void send_frankenshot_feeding_indication(void) {
     }
 }
 
+void send_frankenshot_status_indication(void) {
+    if (frankenshot_status_ind_status && frankenshot_status_chr_conn_handle_inited) {
+        ble_gatts_indicate(frankenshot_status_chr_conn_handle,
+                           frankenshot_status_chr_val_handle);
+        ESP_LOGI(TAG, "frankenshot status indication sent!");
+    }
+}
+
 void update_frankenshot_config(void) {
     frankenshot_config.speed = (uint8_t)(esp_random() % 11);
     frankenshot_config.height = (uint8_t)(esp_random() % 11);
@@ -655,8 +1081,17 @@ int gatt_svc_init(void) {
     /* Local variables */
     int rc = 0;
 
-    /* 1. GATT service initialization */
+    /* 1. GATT service initialization, idle policy from NVS if stored */
     ble_svc_gatt_init();
+    frankenshot_idle_t idle;
+    if (settings_load("idle", &idle, sizeof(idle)) == ESP_OK &&
+        idle.policy <= FRANKENSHOT_IDLE_REDUCED && idle.speed >= 1 && idle.speed <= 10) {
+        frankenshot_idle = idle;
+    }
+    uint8_t prestage;
+    if (settings_load("prestage", &prestage, sizeof(prestage)) == ESP_OK) {
+        feed_set_prestage(prestage == 1);
+    }
 
     /* 2. Update GATT services counter */
     rc = ble_gatts_count_cfg(gatt_svr_svcs);
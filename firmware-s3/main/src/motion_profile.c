@@ -0,0 +1,119 @@
+#include "common.h"
+#include "motion_profile.h"
+
+#include <math.h>
+
+#define MOTION_SIM_DT_S     10e-6f   // integration step while building a ramp
+
+static uint32_t interval_to_fixed(float seconds)
+{
+    return (uint32_t)(seconds * 1e6f * (1 << MOTION_INTERVAL_FRAC_BITS) + 0.5f);
+}
+
+/* Durations of the jerk and constant acceleration phases from v0 to vmax,
+ * returns the acceleration actually reached */
+static float ramp_phases(float dv, float accel, float jerk, float *t_jerk, float *t_const)
+{
+    float peak = accel;
+
+    *t_jerk = 0.0f;
+    if (jerk > 0.0f) {
+        if (dv > accel * accel / jerk) {
+            *t_jerk = accel / jerk;
+        } else {
+            /* Too short to reach full acceleration */
+            peak = sqrtf(dv * jerk);
+            *t_jerk = peak / jerk;
+        }
+        *t_const = dv / peak - *t_jerk;
+    } else {
+        *t_const = dv / accel;
+    }
+    return peak;
+}
+
+uint32_t motion_profile_ramp_steps(const step_profile_t *profile)
+{
+    float v0 = profile->start_sps > 0 ? (float)profile->start_sps : 1.0f;
+    float vmax = (float)profile->max_sps;
+    float accel = profile->accel_sps2 > 0 ? (float)profile->accel_sps2 : 1.0f;
+    float t_jerk, t_const;
+
+    if (vmax <= v0) {
+        return 1;
+    }
+    ramp_phases(vmax - v0, accel, (float)profile->jerk_sps3, &t_jerk, &t_const);
+
+    /* The ramp is point symmetric, the mean speed is halfway */
+    float steps = 0.5f * (v0 + vmax) * (2.0f * t_jerk + t_const);
+    return (uint32_t)steps + 2;
+}
+
+/*
+ * The ramp is built in the time domain: acceleration rises with the jerk limit,
+ * holds at accel_sps2 and falls back to zero as max_sps is reached, then the
+ * velocity is integrated and the time at which each whole step is crossed is
+ * recorded. Without a jerk limit the rise and fall phases vanish and the
+ * result is the constant acceleration ramp of a trapezoid.
+ */
+uint32_t motion_profile_build_ramp(const step_profile_t *profile,
+                                   uint32_t *intervals, uint32_t max_len)
+{
+    float v0 = profile->start_sps > 0 ? (float)profile->start_sps : 1.0f;
+    float vmax = (float)profile->max_sps;
+    float accel = profile->accel_sps2 > 0 ? (float)profile->accel_sps2 : 1.0f;
+    float jerk = (float)profile->jerk_sps3;
+
+    if (max_len == 0) {
+        return 0;
+    }
+    if (vmax <= v0 || max_len == 1) {
+        intervals[0] = interval_to_fixed(1.0f / v0);
+        return 1;
+    }
+
+    float t_jerk;           // duration of each jerk phase
+    float t_const;          // duration of the constant acceleration phase
+    float peak = ramp_phases(vmax - v0, accel, jerk, &t_jerk, &t_const);
+    float t_total = 2.0f * t_jerk + t_const;
+    float v_jerk = 0.5f * peak * t_jerk;    // speed gained in one jerk phase
+
+    uint32_t len = 0;
+    float t = 0.0f;
+    float x = 0.0f;
+    float t_last_step = 0.0f;
+
+    while (t < t_total && len < max_len - 1) {
+        float tm = t + 0.5f * MOTION_SIM_DT_S;
+        float v;
+
+        if (tm < t_jerk) {
+            v = v0 + 0.5f * peak / t_jerk * tm * tm;
+        } else if (tm < t_jerk + t_const) {
+            v = v0 + v_jerk + peak * (tm - t_jerk);
+        } else if (t_jerk > 0.0f) {
+            float tau = t_total - tm;
+            v = vmax - 0.5f * peak / t_jerk * tau * tau;
+        } else {
+            v = vmax;
+        }
+
+        float x_next = x + v * MOTION_SIM_DT_S;
+        if (x_next >= (float)(len + 1)) {
+            /* Interpolate the crossing inside this integration step */
+            float t_step = t + ((float)(len + 1) - x) / v;
+            intervals[len++] = interval_to_fixed(t_step - t_last_step);
+            t_last_step = t_step;
+        }
+        x = x_next;
+        t += MOTION_SIM_DT_S;
+    }
+
+    if (t < t_total && len > 0) {
+        /* Out of room, cruise at the speed reached rather than jump to vmax */
+        intervals[len] = intervals[len - 1];
+        return len + 1;
+    }
+    intervals[len++] = interval_to_fixed(1.0f / vmax);
+    return len;
+}
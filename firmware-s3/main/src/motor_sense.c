@@ -0,0 +1,105 @@
+#include "common.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "motor_sense.h"
+
+// IS outputs stay below ~2.5 V with the sense resistors fitted
+#define SENSE_ATTEN  ADC_ATTEN_DB_12
+
+static const char *MTAG = "SENSE";
+
+typedef struct {
+    adc_channel_t channel;
+    adc_cali_handle_t cali;     // NULL reads raw counts scaled to the full range
+} sense_input_t;
+
+static adc_oneshot_unit_handle_t s_adc = NULL;
+static sense_input_t s_inputs[MOTOR_SENSE_MAX_INPUTS];
+static int s_input_count = 0;
+
+static bool sense_unit_init(void)
+{
+    if (s_adc != NULL) {
+        return true;
+    }
+
+    adc_oneshot_unit_init_cfg_t unit_cfg = {
+        .unit_id = ADC_UNIT_1,
+        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    };
+    esp_err_t err = adc_oneshot_new_unit(&unit_cfg, &s_adc);
+    if (err != ESP_OK) {
+        ESP_LOGE(MTAG, "failed to init adc: %s", esp_err_to_name(err));
+        s_adc = NULL;
+        return false;
+    }
+    return true;
+}
+
+int motor_sense_add(gpio_num_t gpio)
+{
+    adc_unit_t unit;
+    adc_channel_t channel;
+
+    if (s_input_count >= MOTOR_SENSE_MAX_INPUTS || !sense_unit_init()) {
+        return -1;
+    }
+    if (adc_oneshot_io_to_channel(gpio, &unit, &channel) != ESP_OK || unit != ADC_UNIT_1) {
+        ESP_LOGE(MTAG, "GPIO %d is not an ADC1 input", gpio);
+        return -1;
+    }
+
+    adc_oneshot_chan_cfg_t chan_cfg = {
+        .atten = SENSE_ATTEN,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    if (adc_oneshot_config_channel(s_adc, channel, &chan_cfg) != ESP_OK) {
+        ESP_LOGE(MTAG, "failed to configure GPIO %d", gpio);
+        return -1;
+    }
+
+    sense_input_t *in = &s_inputs[s_input_count];
+    in->channel = channel;
+    in->cali = NULL;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_cfg = {
+        .unit_id = ADC_UNIT_1,
+        .chan = channel,
+        .atten = SENSE_ATTEN,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &in->cali) != ESP_OK) {
+        ESP_LOGW(MTAG, "no calibration for GPIO %d, using raw counts", gpio);
+        in->cali = NULL;
+    }
+#endif
+
+    return s_input_count++;
+}
+
+int32_t motor_sense_read_mv(int input, uint32_t samples)
+{
+    int64_t sum = 0;
+    int raw;
+
+    if (input < 0 || input >= s_input_count || samples == 0) {
+        return -1;
+    }
+
+    sense_input_t *in = &s_inputs[input];
+    for (uint32_t i = 0; i < samples; i++) {
+        if (adc_oneshot_read(s_adc, in->channel, &raw) != ESP_OK) {
+            return -1;
+        }
+        sum += raw;
+    }
+    raw = (int)(sum / samples);
+
+    int mv;
+    if (in->cali == NULL || adc_cali_raw_to_voltage(in->cali, raw, &mv) != ESP_OK) {
+        // uncalibrated, roughly 3.1 V full scale at 12 dB
+        mv = raw * 3100 / 4095;
+    }
+    return mv;
+}
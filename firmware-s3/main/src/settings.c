@@ -0,0 +1,47 @@
+#include "common.h"
+#include "settings.h"
+
+#define SETTINGS_NAMESPACE  "frankenshot"
+
+static const char *CTAG = "SETTINGS";
+
+esp_err_t settings_load(const char *key, void *value, size_t len)
+{
+    nvs_handle_t handle;
+    size_t size = len;
+
+    esp_err_t err = nvs_open(SETTINGS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_get_blob(handle, key, value, &size);
+    nvs_close(handle);
+    if (err == ESP_OK && size != len) {
+        ESP_LOGW(CTAG, "%s: stored size %u, expected %u", key, size, len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return err;
+}
+
+esp_err_t settings_save(const char *key, const void *value, size_t len)
+{
+    nvs_handle_t handle;
+
+    esp_err_t err = nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(CTAG, "failed to open nvs: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(handle, key, value, len);
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(CTAG, "failed to save %s: %s", key, esp_err_to_name(err));
+    }
+    return err;
+}
@@ -0,0 +1,669 @@
+#include "common.h"
+#include "step_engine.h"
+#include "driver/gptimer.h"
+#include "esp_heap_caps.h"
+#include <freertos/semphr.h>
+
+static const char *STAG = "STEP";
+
+/* ===== TIMER CONFIG ===== */
+#define STEP_TIMER_RESOLUTION_HZ   1000000  // 1 tick = 1 us
+#define STEP_START_DELAY_US        50       // DIR setup time before first edge
+#define STEP_EDGE_SLACK_US         2        // edges this close are handled together
+#define STEP_SEEK_DEBOUNCE         3        // consecutive steps at switch level
+#define STEP_FRAC_BITS             MOTION_INTERVAL_FRAC_BITS
+#define STEP_SCALE_ONE             256      // time scale of 1.0, 8 fractional bits
+#define STEP_SCALE_MAX             (16 * STEP_SCALE_ONE)
+
+typedef struct {
+    gpio_num_t step_gpio;
+    step_done_cb_t done_cb;
+    void *done_ctx;
+
+    /* Precomputed acceleration ramp, intervals in 1/256 timer ticks.
+     * ramp[0] is the start speed, ramp[ramp_len - 1] the cruise speed. */
+    uint32_t *ramp;
+    uint32_t ramp_len;
+
+    volatile int32_t position;
+    volatile bool active;
+    int8_t dir;
+    int32_t remaining;
+    bool pin_high;
+    uint64_t next_edge;
+
+    /* Ramp state */
+    uint32_t interval;
+    uint32_t ramp_pos;
+    uint32_t time_scale;        // stretches the ramp for timed moves
+
+    bool seeking;
+    gpio_num_t seek_gpio;
+    int seek_level;
+    uint8_t seek_count;
+    uint32_t ramp_limit;        // ramp entries to climb, caps seeks and runs
+    bool seek_limited;          // give up once remaining runs out
+
+    /* Switch edge latched by the GPIO interrupt while seeking */
+    bool latched;
+    int32_t latch_position;
+
+    /* Switch edges reported while moving */
+    gpio_num_t isr_gpio;        // pin the edge interrupt is attached to
+    step_watch_cb_t watch_cb;
+    void *watch_ctx;
+    int watch_level;
+
+    /* One shot callback once the position reaches or passes trigger_position */
+    step_done_cb_t trigger_cb;
+    void *trigger_ctx;
+    int32_t trigger_position;
+    bool trigger_armed;
+    bool trigger_fired;
+} step_channel_t;
+
+static step_channel_t s_channels[STEP_AXIS_COUNT];
+static gptimer_handle_t s_timer = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+/* Guards ramp tables against being freed while a task walks them */
+static SemaphoreHandle_t s_profile_mutex = NULL;
+static bool s_isr_service = false;
+
+/* Arm the alarm for the earliest pending edge, or disarm when idle.
+ * Must be called with s_lock held. */
+static void IRAM_ATTR step_schedule(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (int i = 0; i < STEP_AXIS_COUNT; i++) {
+        if (s_channels[i].active && s_channels[i].next_edge < next) {
+            next = s_channels[i].next_edge;
+        }
+    }
+
+    if (next == UINT64_MAX) {
+        gptimer_set_alarm_action(s_timer, NULL);
+        return;
+    }
+
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = next,
+    };
+    gptimer_set_alarm_action(s_timer, &alarm);
+}
+
+static inline uint32_t IRAM_ATTR step_scaled(const step_channel_t *ch, uint32_t interval)
+{
+    return (uint32_t)(((uint64_t)interval * ch->time_scale) / STEP_SCALE_ONE);
+}
+
+/*
+ * Interval of the next step, a walk along the precomputed ramp. Accelerate
+ * while the remaining steps still cover the way back down, cruise at the end
+ * of the table and walk back towards the start speed for the last steps.
+ */
+static void IRAM_ATTR step_ramp(step_channel_t *ch)
+{
+    if (ch->seeking) {
+        /* Fast seeks accelerate up to their speed and hold it */
+        if (ch->ramp_pos < ch->ramp_limit) {
+            ch->interval = ch->ramp[ch->ramp_pos];
+            ch->ramp_pos++;
+        }
+        return;
+    }
+
+    if ((uint32_t)ch->remaining <= ch->ramp_pos) {
+        if (ch->ramp_pos > 0) {
+            ch->ramp_pos--;
+        }
+        ch->interval = step_scaled(ch, ch->ramp[ch->ramp_pos]);
+    } else if (ch->ramp_pos < ch->ramp_len && ch->ramp_pos < ch->ramp_limit) {
+        ch->interval = step_scaled(ch, ch->ramp[ch->ramp_pos]);
+        ch->ramp_pos++;
+    }
+}
+
+/* The switch has been confirmed, or the seek gave up. A seek faster than the
+ * start speed ramps back down like the end of a move and overshoots by the
+ * stopping distance. Returns true if the channel stopped right away. */
+static bool IRAM_ATTR step_seek_end(step_channel_t *ch)
+{
+    ch->seeking = false;
+    if (ch->ramp_pos > 0) {
+        ch->remaining = ch->ramp_pos;
+        return false;
+    }
+    ch->remaining = 0;
+    ch->active = false;
+    return true;
+}
+
+/* Switch edge. While seeking it records the exact step the switch changed
+ * at, during moves it is handed to the watch callback. */
+static void IRAM_ATTR step_switch_isr(void *arg)
+{
+    step_channel_t *ch = arg;
+    step_watch_cb_t watch_cb = NULL;
+    int32_t position = 0;
+    int8_t dir = 0;
+    bool woken = false;
+
+    portENTER_CRITICAL_ISR(&s_lock);
+    int level = gpio_get_level(ch->isr_gpio);
+    if (ch->seeking) {
+        if (!ch->latched && level == ch->seek_level) {
+            ch->latch_position = ch->position;
+            ch->latched = true;
+        }
+    } else if (ch->active && ch->watch_cb && level == ch->watch_level) {
+        watch_cb = ch->watch_cb;
+        position = ch->position;
+        dir = ch->dir;
+    }
+    portEXIT_CRITICAL_ISR(&s_lock);
+
+    if (watch_cb) {
+        woken = watch_cb((step_axis_t)(ch - s_channels), position, dir, ch->watch_ctx);
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/* Process one edge, returns true once the channel has finished. */
+static bool IRAM_ATTR step_edge(step_channel_t *ch)
+{
+    uint32_t period = ch->interval >> STEP_FRAC_BITS;
+
+    if (!ch->pin_high) {
+        /* A retarget may have cut the move short */
+        if (!ch->seeking && ch->remaining <= 0) {
+            ch->active = false;
+            return true;
+        }
+        gpio_set_level(ch->step_gpio, 1);
+        ch->pin_high = true;
+        ch->position += ch->dir;
+        if (!ch->seeking || ch->seek_limited) {
+            ch->remaining--;
+        }
+        /* Crossing rather than equality, a correction or a late arm may
+         * have moved the axis past the trigger already */
+        if (ch->trigger_armed &&
+            (ch->dir > 0 ? ch->position >= ch->trigger_position
+                         : ch->position <= ch->trigger_position)) {
+            ch->trigger_armed = false;
+            ch->trigger_fired = true;
+        }
+        /* 50% duty, the low phase takes the rest of the interval */
+        ch->next_edge += period / 2;
+        return false;
+    }
+
+    gpio_set_level(ch->step_gpio, 0);
+    ch->pin_high = false;
+    ch->next_edge += period - period / 2;
+    step_ramp(ch);
+
+    if (ch->seeking) {
+        if (gpio_get_level(ch->seek_gpio) == ch->seek_level) {
+            if (ch->seek_count == 0 && !ch->latched) {
+                /* Already at level when the seek started, no edge to latch */
+                ch->latch_position = ch->position;
+                ch->latched = true;
+            }
+            if (++ch->seek_count >= STEP_SEEK_DEBOUNCE) {
+                return step_seek_end(ch);
+            }
+        } else {
+            /* Contact bounced, latch the next edge again */
+            ch->seek_count = 0;
+            ch->latched = false;
+        }
+        if (ch->seek_limited && ch->remaining <= 0) {
+            ch->seek_count = 0;
+            ch->latched = false;
+            return step_seek_end(ch);
+        }
+        return false;
+    }
+
+    if (ch->remaining <= 0) {
+        ch->active = false;
+        return true;
+    }
+    return false;
+}
+
+static bool IRAM_ATTR step_on_alarm(gptimer_handle_t timer,
+                                    const gptimer_alarm_event_data_t *edata,
+                                    void *user_ctx)
+{
+    uint32_t finished = 0;
+    uint32_t fired = 0;
+    bool woken = false;
+
+    portENTER_CRITICAL_ISR(&s_lock);
+    for (int i = 0; i < STEP_AXIS_COUNT; i++) {
+        step_channel_t *ch = &s_channels[i];
+        if (ch->active &&
+            ch->next_edge <= edata->count_value + STEP_EDGE_SLACK_US &&
+            step_edge(ch)) {
+            finished |= 1u << i;
+        }
+        if (ch->trigger_fired) {
+            ch->trigger_fired = false;
+            fired |= 1u << i;
+        }
+    }
+    step_schedule();
+    portEXIT_CRITICAL_ISR(&s_lock);
+
+    /* Callbacks run outside the lock so they may use FreeRTOS FromISR APIs */
+    for (int i = 0; i < STEP_AXIS_COUNT; i++) {
+        if ((fired & (1u << i)) && s_channels[i].trigger_cb) {
+            woken |= s_channels[i].trigger_cb((step_axis_t)i, s_channels[i].trigger_ctx);
+        }
+    }
+    for (int i = 0; i < STEP_AXIS_COUNT; i++) {
+        if ((finished & (1u << i)) && s_channels[i].done_cb) {
+            woken |= s_channels[i].done_cb((step_axis_t)i, s_channels[i].done_ctx);
+        }
+    }
+    return woken;
+}
+
+static void step_engine_init(void)
+{
+    gptimer_config_t timer_cfg = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = STEP_TIMER_RESOLUTION_HZ,
+    };
+    ESP_ERROR_CHECK(gptimer_new_timer(&timer_cfg, &s_timer));
+    s_profile_mutex = xSemaphoreCreateMutex();
+    for (int i = 0; i < STEP_AXIS_COUNT; i++) {
+        s_channels[i].isr_gpio = GPIO_NUM_NC;
+    }
+
+    gptimer_event_callbacks_t cbs = {
+        .on_alarm = step_on_alarm,
+    };
+    ESP_ERROR_CHECK(gptimer_register_event_callbacks(s_timer, &cbs, NULL));
+    ESP_ERROR_CHECK(gptimer_enable(s_timer));
+    /* Free running, the alarm is only armed while an axis is active */
+    ESP_ERROR_CHECK(gptimer_start(s_timer));
+
+    ESP_LOGI(STAG, "Step engine initialized");
+}
+
+void step_engine_axis_init(step_axis_t axis, gpio_num_t step_gpio,
+                           const step_profile_t *profile,
+                           step_done_cb_t done_cb, void *ctx)
+{
+    if (s_timer == NULL) {
+        step_engine_init();
+    }
+
+    step_channel_t *ch = &s_channels[axis];
+    step_engine_stop(axis);
+
+    portENTER_CRITICAL(&s_lock);
+    ch->step_gpio = step_gpio;
+    ch->done_cb = done_cb;
+    ch->done_ctx = ctx;
+    portEXIT_CRITICAL(&s_lock);
+
+    step_engine_set_profile(axis, profile);
+    /* Later profile changes keep the old table if allocation fails, the
+     * first one has nothing to fall back on */
+    if (ch->ramp == NULL) {
+        ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
+    }
+}
+
+uint32_t step_engine_set_profile(step_axis_t axis, const step_profile_t *profile)
+{
+    step_channel_t *ch = &s_channels[axis];
+    uint32_t needed = motion_profile_ramp_steps(profile);
+    uint32_t size = needed < MOTION_RAMP_MAX_STEPS ? needed : MOTION_RAMP_MAX_STEPS;
+    uint32_t *ramp = heap_caps_malloc(size * sizeof(uint32_t),
+                                      MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+    if (ramp == NULL) {
+        ESP_LOGE(STAG, "Axis %d: no memory for ramp table", axis);
+        return ch->ramp ? (uint32_t)((1000000ULL << MOTION_INTERVAL_FRAC_BITS) /
+                                     ch->ramp[ch->ramp_len - 1]) : 0;
+    }
+
+    uint32_t len = motion_profile_build_ramp(profile, ramp, size);
+    uint32_t max_sps = profile->max_sps;
+    if (needed > size) {
+        max_sps = (uint32_t)((1000000ULL << MOTION_INTERVAL_FRAC_BITS) / ramp[len - 1]);
+        ESP_LOGW(STAG, "Axis %d: ramp needs %lu steps, cruise limited to %lu sps",
+                 axis, needed, max_sps);
+    }
+
+    /* Swap tables under the lock, the ISR never keeps a pointer across edges */
+    xSemaphoreTake(s_profile_mutex, portMAX_DELAY);
+    portENTER_CRITICAL(&s_lock);
+    uint32_t *old = ch->ramp;
+    ch->ramp = ramp;
+    ch->ramp_len = len;
+    if (ch->ramp_pos > len) {
+        ch->ramp_pos = len;
+    }
+    /* Seeks and runs index the table up to ramp_limit */
+    if (ch->ramp_limit > len) {
+        ch->ramp_limit = len;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    heap_caps_free(old);
+    xSemaphoreGive(s_profile_mutex);
+
+    ESP_LOGI(STAG, "Axis %d profile: start=%lu max=%lu accel=%lu jerk=%lu ramp=%lu steps",
+             axis, profile->start_sps, profile->max_sps, profile->accel_sps2,
+             profile->jerk_sps3, len);
+    return max_sps;
+}
+
+/* Walks the ramp the same way the ISR does, summing up the step periods */
+static uint64_t step_natural_duration(const step_channel_t *ch, int32_t steps)
+{
+    uint64_t total = 0;
+    uint32_t interval = ch->ramp[0];
+    uint32_t pos = 0;
+
+    while (steps > 0) {
+        total += interval >> STEP_FRAC_BITS;
+        steps--;
+        if ((uint32_t)steps <= pos) {
+            if (pos > 0) {
+                pos--;
+            }
+            interval = ch->ramp[pos];
+        } else if (pos < ch->ramp_len) {
+            interval = ch->ramp[pos];
+            pos++;
+        }
+    }
+    return total;
+}
+
+uint32_t step_engine_move_duration_us(step_axis_t axis, int32_t steps)
+{
+    xSemaphoreTake(s_profile_mutex, portMAX_DELAY);
+    uint64_t duration = step_natural_duration(&s_channels[axis], steps);
+    xSemaphoreGive(s_profile_mutex);
+
+    return duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+}
+
+/* Must be called with s_lock held, the first step follows delay_us later */
+static void step_start(step_channel_t *ch, int8_t dir, uint32_t delay_us)
+{
+    uint64_t now = 0;
+    gptimer_get_raw_count(s_timer, &now);
+
+    ch->dir = dir;
+    ch->pin_high = false;
+    ch->interval = step_scaled(ch, ch->ramp[0]);
+    ch->ramp_pos = 0;
+    ch->next_edge = now + STEP_START_DELAY_US + delay_us;
+    ch->active = true;
+    step_schedule();
+}
+
+void step_engine_move(step_axis_t axis, int32_t steps, int8_t dir,
+                      uint32_t duration_us)
+{
+    step_channel_t *ch = &s_channels[axis];
+    uint32_t scale = STEP_SCALE_ONE;
+    uint32_t hold_us = 0;
+
+    if (steps <= 0) {
+        return;
+    }
+
+    if (duration_us > 0) {
+        /* Stretch the whole profile evenly, which keeps its shape and only
+         * lowers speeds and accelerations */
+        uint64_t natural = step_engine_move_duration_us(axis, steps);
+        if (natural > 0 && duration_us > natural) {
+            uint64_t s = ((uint64_t)duration_us * STEP_SCALE_ONE) / natural;
+            scale = s > STEP_SCALE_MAX ? STEP_SCALE_MAX : (uint32_t)s;
+            /* Stretched further the speeds would drop below what the motor
+             * turns smoothly at, wait out the rest before the first step */
+            if (s > STEP_SCALE_MAX) {
+                hold_us = duration_us - (uint32_t)(natural * STEP_SCALE_MAX / STEP_SCALE_ONE);
+            }
+        }
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    ch->seeking = false;
+    ch->remaining = steps;
+    ch->ramp_limit = UINT32_MAX;
+    ch->time_scale = scale;
+    step_start(ch, dir, hold_us);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* Ramp entries it takes to reach sps, 0 if sps is at or below the start
+ * speed, which then stays at the fixed *interval. Call with the profile
+ * mutex held. */
+static uint32_t step_ramp_limit(const step_channel_t *ch, uint32_t sps,
+                                uint32_t *interval)
+{
+    uint32_t limit = 1;
+    uint32_t target = sps > 0 ?
+        (uint32_t)(((uint64_t)STEP_TIMER_RESOLUTION_HZ << STEP_FRAC_BITS) / sps) : 0;
+
+    if (sps == 0 || target >= ch->ramp[0]) {
+        *interval = sps == 0 ? ch->ramp[0] : target;
+        return 0;
+    }
+    while (limit < ch->ramp_len && ch->ramp[limit - 1] > target) {
+        limit++;
+    }
+    *interval = ch->ramp[0];
+    return limit;
+}
+
+void step_engine_run(step_axis_t axis, int8_t dir, uint32_t sps)
+{
+    step_channel_t *ch = &s_channels[axis];
+    uint32_t interval;
+
+    xSemaphoreTake(s_profile_mutex, portMAX_DELAY);
+    uint32_t limit = step_ramp_limit(ch, sps, &interval);
+
+    portENTER_CRITICAL(&s_lock);
+    ch->seeking = false;
+    ch->remaining = INT32_MAX;
+    ch->ramp_limit = limit;
+    ch->time_scale = STEP_SCALE_ONE;
+    step_start(ch, dir, 0);
+    ch->interval = interval;
+    portEXIT_CRITICAL(&s_lock);
+    xSemaphoreGive(s_profile_mutex);
+}
+
+/* Edge interrupt on the switch of an axis. The interrupt is enabled again
+ * even if already attached, a gpio_config() of the pin turns it off. */
+static void step_switch_attach(step_channel_t *ch, gpio_num_t switch_gpio)
+{
+    if (ch->isr_gpio == switch_gpio) {
+        gpio_set_intr_type(switch_gpio, GPIO_INTR_ANYEDGE);
+        gpio_intr_enable(switch_gpio);
+        return;
+    }
+    if (!s_isr_service) {
+        esp_err_t err = gpio_install_isr_service(0);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            ESP_LOGE(STAG, "GPIO ISR service failed: %s", esp_err_to_name(err));
+            return;
+        }
+        s_isr_service = true;
+    }
+    if (ch->isr_gpio != GPIO_NUM_NC) {
+        gpio_isr_handler_remove(ch->isr_gpio);
+    }
+    gpio_set_intr_type(switch_gpio, GPIO_INTR_ANYEDGE);
+    gpio_isr_handler_add(switch_gpio, step_switch_isr, ch);
+    gpio_intr_enable(switch_gpio);
+    ch->isr_gpio = switch_gpio;
+}
+
+void step_engine_seek(step_axis_t axis, int8_t dir, gpio_num_t switch_gpio,
+                      bool level, uint32_t sps, int32_t max_steps)
+{
+    step_channel_t *ch = &s_channels[axis];
+    uint32_t interval;
+
+    step_switch_attach(ch, switch_gpio);
+
+    xSemaphoreTake(s_profile_mutex, portMAX_DELAY);
+    uint32_t limit = step_ramp_limit(ch, sps, &interval);
+
+    portENTER_CRITICAL(&s_lock);
+    ch->seeking = true;
+    ch->time_scale = STEP_SCALE_ONE;
+    ch->seek_gpio = switch_gpio;
+    ch->seek_level = level ? 1 : 0;
+    ch->seek_count = 0;
+    ch->ramp_limit = limit;
+    ch->seek_limited = max_steps > 0;
+    ch->remaining = max_steps;
+    ch->latched = false;
+    step_start(ch, dir, 0);
+    ch->interval = interval;
+    portEXIT_CRITICAL(&s_lock);
+    xSemaphoreGive(s_profile_mutex);
+}
+
+bool step_engine_seek_latch(step_axis_t axis, int32_t *position)
+{
+    step_channel_t *ch = &s_channels[axis];
+    bool latched;
+
+    portENTER_CRITICAL(&s_lock);
+    latched = ch->latched;
+    *position = ch->latch_position;
+    portEXIT_CRITICAL(&s_lock);
+
+    return latched;
+}
+
+bool step_engine_retarget(step_axis_t axis, int32_t target)
+{
+    step_channel_t *ch = &s_channels[axis];
+    bool reachable = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (ch->active && !ch->seeking) {
+        /* Steps still ahead in the current direction, negative if behind */
+        int32_t ahead = (target - ch->position) * ch->dir;
+
+        if (ahead >= 0 && (uint32_t)ahead >= ch->ramp_pos) {
+            /* A run turns into a move, free to use the whole ramp */
+            ch->remaining = ahead;
+            ch->ramp_limit = UINT32_MAX;
+            reachable = true;
+        } else {
+            /* Behind or too close to stop in time, ramp down as fast as the
+             * profile allows and let the caller reverse from there */
+            ch->remaining = ch->ramp_pos;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    return reachable;
+}
+
+uint32_t step_engine_stop_steps(step_axis_t axis)
+{
+    step_channel_t *ch = &s_channels[axis];
+    uint32_t steps;
+
+    portENTER_CRITICAL(&s_lock);
+    steps = ch->active ? ch->ramp_pos : 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    return steps;
+}
+
+void step_engine_watch(step_axis_t axis, gpio_num_t switch_gpio, bool level,
+                       step_watch_cb_t cb, void *ctx)
+{
+    step_channel_t *ch = &s_channels[axis];
+
+    step_switch_attach(ch, switch_gpio);
+
+    portENTER_CRITICAL(&s_lock);
+    ch->watch_level = level ? 1 : 0;
+    ch->watch_ctx = ctx;
+    ch->watch_cb = cb;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void step_engine_correct(step_axis_t axis, int32_t offset)
+{
+    step_channel_t *ch = &s_channels[axis];
+
+    portENTER_CRITICAL(&s_lock);
+    ch->position += offset;
+    if (ch->active && !ch->seeking) {
+        /* Keep the end point, as far as there is room left to stop */
+        int32_t remaining = ch->remaining - offset * ch->dir;
+        ch->remaining = remaining > (int32_t)ch->ramp_pos ? remaining : (int32_t)ch->ramp_pos;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void step_engine_trigger(step_axis_t axis, int32_t position,
+                         step_done_cb_t cb, void *ctx)
+{
+    step_channel_t *ch = &s_channels[axis];
+
+    portENTER_CRITICAL(&s_lock);
+    ch->trigger_cb = cb;
+    ch->trigger_ctx = ctx;
+    ch->trigger_position = position;
+    ch->trigger_fired = false;
+    ch->trigger_armed = cb != NULL;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void step_engine_stop(step_axis_t axis)
+{
+    step_channel_t *ch = &s_channels[axis];
+
+    portENTER_CRITICAL(&s_lock);
+    if (ch->pin_high) {
+        gpio_set_level(ch->step_gpio, 0);
+        ch->pin_high = false;
+    }
+    ch->active = false;
+    step_schedule();
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool step_engine_busy(step_axis_t axis)
+{
+    return s_channels[axis].active;
+}
+
+int32_t step_engine_get_position(step_axis_t axis)
+{
+    return s_channels[axis].position;
+}
+
+void step_engine_set_position(step_axis_t axis, int32_t pos)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_channels[axis].position = pos;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,140 @@
+#include "common.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "switch_input.h"
+
+static const char *SWTAG = "SWITCH";
+
+typedef struct {
+    gpio_num_t gpio;
+    uint32_t debounce_us;
+    QueueHandle_t queue;
+    esp_timer_handle_t settle;  // checks the level again once the window ends
+    bool stable;                // debounced level
+    int64_t change_us;          // when stable last changed
+    int64_t edge_us;            // last edge seen, bounces included
+} switch_input_t;
+
+static switch_input_t s_inputs[SWITCH_INPUT_MAX_INPUTS];
+static int s_input_count = 0;
+static bool s_isr_service = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// call with s_lock held
+static inline void IRAM_ATTR switch_accept(switch_input_t *sw, bool level,
+                                           int64_t time_us, switch_event_t *ev)
+{
+    sw->stable = level;
+    sw->change_us = time_us;
+    ev->input = sw - s_inputs;
+    ev->level = level;
+    ev->time_us = time_us;
+}
+
+static void IRAM_ATTR switch_isr(void *arg)
+{
+    switch_input_t *sw = arg;
+    int64_t now = esp_timer_get_time();
+    switch_event_t ev;
+    bool report = false;
+    BaseType_t woken = pdFALSE;
+
+    portENTER_CRITICAL_ISR(&s_lock);
+    bool level = gpio_get_level(sw->gpio) == 1;
+    sw->edge_us = now;
+    if (now - sw->change_us >= sw->debounce_us && level != sw->stable) {
+        switch_accept(sw, level, now, &ev);
+        report = true;
+    }
+    portEXIT_CRITICAL_ISR(&s_lock);
+
+    if (report) {
+        xQueueSendFromISR(sw->queue, &ev, &woken);
+        esp_timer_stop(sw->settle);
+        esp_timer_start_once(sw->settle, sw->debounce_us);
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/* End of the debounce window. If the switch bounced back and stayed there the
+ * change happened at its last edge. */
+static void switch_settle(void *arg)
+{
+    switch_input_t *sw = arg;
+    switch_event_t ev;
+    bool report = false;
+
+    portENTER_CRITICAL(&s_lock);
+    bool level = gpio_get_level(sw->gpio) == 1;
+    if (level != sw->stable) {
+        switch_accept(sw, level, sw->edge_us, &ev);
+        report = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (report) {
+        xQueueSend(sw->queue, &ev, 0);
+        esp_timer_start_once(sw->settle, sw->debounce_us);
+    }
+}
+
+int switch_input_add(gpio_num_t gpio, uint32_t debounce_us, QueueHandle_t queue)
+{
+    if (s_input_count >= SWITCH_INPUT_MAX_INPUTS || queue == NULL) {
+        return -1;
+    }
+    if (!s_isr_service) {
+        esp_err_t err = gpio_install_isr_service(0);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            ESP_LOGE(SWTAG, "GPIO ISR service failed: %s", esp_err_to_name(err));
+            return -1;
+        }
+        s_isr_service = true;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    if (gpio_config(&io_conf) != ESP_OK) {
+        ESP_LOGE(SWTAG, "failed to configure GPIO %d", gpio);
+        return -1;
+    }
+
+    switch_input_t *sw = &s_inputs[s_input_count];
+    sw->gpio = gpio;
+    sw->debounce_us = debounce_us;
+    sw->queue = queue;
+    sw->stable = gpio_get_level(gpio) == 1;
+    sw->change_us = esp_timer_get_time();
+    sw->edge_us = sw->change_us;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = switch_settle,
+        .arg = sw,
+        .name = "switch",
+    };
+    if (esp_timer_create(&timer_args, &sw->settle) != ESP_OK) {
+        ESP_LOGE(SWTAG, "no debounce timer for GPIO %d", gpio);
+        return -1;
+    }
+    if (gpio_isr_handler_add(gpio, switch_isr, sw) != ESP_OK) {
+        ESP_LOGE(SWTAG, "failed to attach GPIO %d", gpio);
+        esp_timer_delete(sw->settle);
+        return -1;
+    }
+
+    return s_input_count++;
+}
+
+bool switch_input_level(int input)
+{
+    if (input < 0 || input >= s_input_count) {
+        return false;
+    }
+    return s_inputs[input].stable;
+}
@@ -0,0 +1,97 @@
+#include "common.h"
+#include "settings.h"
+#include "wheel_cal.h"
+
+#define WHEEL_CAL_KEY  "wheel_cal"
+
+static const char *WCTAG = "WHEEL_CAL";
+
+static wheel_cal_entry_t s_table[WHEEL_CAL_SPEEDS][WHEEL_CAL_SPINS];
+static uint32_t s_full_mv;
+static uint32_t s_max_mv;
+static uint32_t s_spin_divisor;
+
+static void wheel_cal_defaults(void)
+{
+    for (int row = 0; row < WHEEL_CAL_SPEEDS; row++) {
+        int32_t base = (int32_t)((row + 1) * s_full_mv / 10);
+
+        for (int spin = 0; spin < WHEEL_CAL_SPINS; spin++) {
+            int32_t delta = (base * (spin - 5)) / (int32_t)s_spin_divisor;
+            int32_t top = base + delta;
+            int32_t bottom = base - delta;
+            int32_t excess = (top > bottom ? top : bottom) - (int32_t)s_max_mv;
+
+            // give up speed rather than spin at the top end
+            if (excess > 0) {
+                top -= excess;
+                bottom -= excess;
+            }
+            s_table[row][spin].top_mv = top < 0 ? 0 : top;
+            s_table[row][spin].bottom_mv = bottom < 0 ? 0 : bottom;
+        }
+    }
+}
+
+void wheel_cal_init(uint32_t full_mv, uint32_t max_mv, uint32_t spin_divisor)
+{
+    s_full_mv = full_mv;
+    s_max_mv = max_mv;
+    s_spin_divisor = spin_divisor;
+    wheel_cal_defaults();
+
+    if (settings_load(WHEEL_CAL_KEY, s_table, sizeof(s_table)) == ESP_OK) {
+        ESP_LOGI(WCTAG, "Calibration loaded");
+        // tables saved under a higher ceiling hold targets that can't be reached
+        for (int row = 0; row < WHEEL_CAL_SPEEDS; row++) {
+            for (int spin = 0; spin < WHEEL_CAL_SPINS; spin++) {
+                wheel_cal_entry_t *e = &s_table[row][spin];
+                if (e->top_mv > s_max_mv) e->top_mv = s_max_mv;
+                if (e->bottom_mv > s_max_mv) e->bottom_mv = s_max_mv;
+            }
+        }
+    } else {
+        // a partial read may have left garbage behind
+        wheel_cal_defaults();
+    }
+}
+
+void wheel_cal_lookup(uint32_t speed_centi, uint32_t spin,
+                      int32_t *top_mv, int32_t *bottom_mv)
+{
+    if (speed_centi < 100) speed_centi = 100;
+    if (speed_centi > WHEEL_CAL_SPEEDS * 100) speed_centi = WHEEL_CAL_SPEEDS * 100;
+    if (spin >= WHEEL_CAL_SPINS) spin = WHEEL_CAL_SPINS - 1;
+
+    uint32_t row = speed_centi / 100 - 1;
+    int32_t frac = speed_centi % 100;
+    const wheel_cal_entry_t *lo = &s_table[row][spin];
+    const wheel_cal_entry_t *hi = row + 1 < WHEEL_CAL_SPEEDS ? &s_table[row + 1][spin] : lo;
+
+    *top_mv = lo->top_mv + ((int32_t)hi->top_mv - lo->top_mv) * frac / 100;
+    *bottom_mv = lo->bottom_mv + ((int32_t)hi->bottom_mv - lo->bottom_mv) * frac / 100;
+}
+
+bool wheel_cal_set(uint32_t speed, uint32_t spin, const wheel_cal_entry_t *entry)
+{
+    if (speed < 1 || speed > WHEEL_CAL_SPEEDS || spin >= WHEEL_CAL_SPINS ||
+        entry->top_mv > s_max_mv || entry->bottom_mv > s_max_mv) {
+        return false;
+    }
+
+    s_table[speed - 1][spin] = *entry;
+    ESP_LOGI(WCTAG, "speed=%lu spin=%lu: top=%u bottom=%u mV",
+             speed, spin, entry->top_mv, entry->bottom_mv);
+    return true;
+}
+
+esp_err_t wheel_cal_save(void)
+{
+    return settings_save(WHEEL_CAL_KEY, s_table, sizeof(s_table));
+}
+
+esp_err_t wheel_cal_reset(void)
+{
+    wheel_cal_defaults();
+    return wheel_cal_save();
+}